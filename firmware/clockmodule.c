@@ -0,0 +1,88 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     clockmodule.c
+* Info:		Software clock with periodic RTC synchronization.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "clockmodule.h"
+#include "timemodule.h"
+
+UINT _clockSyncCounter;
+INT _clockDrift;
+
+/*************************************************************************
+ Reset software clock synchronization state. This function should be 
+ called after system time is loaded from RTC.
+
+ Return: None
+*************************************************************************/
+VOID initSoftClock()
+{
+	_clockSyncCounter = CLOCK_SYNC_INTERVAL;
+	_clockDrift = 0;
+}
+
+/*************************************************************************
+ Advance software clock by one second. This function should be called 
+ from the 1Hz software clock timer.
+
+ sysTime: System time maintained by the software clock.
+
+ Return: TRUE if RTC synchronization is due, otherwise FALSE.
+*************************************************************************/
+UCHAR tickSoftClock(PTIME sysTime)
+{
+	addSecond(sysTime);
+	
+	if((--_clockSyncCounter) == 0)
+	{
+		_clockSyncCounter = CLOCK_SYNC_INTERVAL;
+		return TRUE;
+	}
+	
+	return FALSE;
+}
+
+/*************************************************************************
+ Synchronize software clock with the time received from RTC and measure
+ the drift between the two clocks.
+
+ sysTime: System time maintained by the software clock.
+ 
+ rtcTime: Time received from RTC.
+
+ Return: None
+*************************************************************************/
+VOID syncSoftClock(PTIME sysTime, PTIME rtcTime)
+{
+	INT32 drift = (INT32)timeToSeconds(sysTime) - (INT32)timeToSeconds(rtcTime);
+	
+	// Drift across midnight.
+	if(drift > (SECONDS_PER_DAY / 2))
+	{
+		drift -= SECONDS_PER_DAY;
+	}
+	else if(drift < -(SECONDS_PER_DAY / 2))
+	{
+		drift += SECONDS_PER_DAY;
+	}
+	
+	_clockDrift = (INT)drift;
+	*sysTime = *rtcTime;
+}
+
+/*************************************************************************
+ Get drift measured on the last RTC synchronization.
+
+ Return: Software clock time minus RTC time in seconds.
+*************************************************************************/
+INT getClockDrift()
+{
+	return _clockDrift;
+}
@@ -0,0 +1,32 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     clockmodule.h
+* Info:		Software clock with periodic RTC synchronization.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef CLOCK_MODULE_HEADER
+#define CLOCK_MODULE_HEADER
+
+// Software clock tick period in milliseconds.
+#define CLOCK_TICK_PERIOD	1000
+
+// Interval between RTC synchronizations in seconds.
+#define CLOCK_SYNC_INTERVAL	600
+
+#define SECONDS_PER_DAY		86400L
+
+// Check the time received from RTC. RTC returns garbage values if the 
+// battery backup fails.
+#define IS_VALID_TIME(t)	(((t)->hours < 24) && ((t)->minutes < 60) && ((t)->seconds < 60))
+
+VOID initSoftClock();
+UCHAR tickSoftClock(PTIME sysTime);
+VOID syncSoftClock(PTIME sysTime, PTIME rtcTime);
+INT getClockDrift();
+
+#endif
@@ -11,39 +11,49 @@
 
 #include "sysbasedef.h"
 #include "displaymodule.h"
+#include "halmodule.h"
 
-#include <util/delay.h>
-#include <avr/io.h>
-
-// Define port outputs for all digits.
-#define DIGIT_0		0x3F
-#define DIGIT_1		0x06
-#define DIGIT_2		0x5B
-#define DIGIT_3		0x4F
-#define DIGIT_4		0x66
-#define DIGIT_5		0x6D
-#define DIGIT_6		0x7D
-#define DIGIT_7		0x07
-#define DIGIT_8		0x7F
-#define DIGIT_9		0x6F
-
-// Define port outputs for English letters.
-#define LETTER_N	0x54
-#define LETTER_F	0x71
-#define LETTER_E	0x79
-#define LETTER_D	0x5E
-#define LETTER_O	0x3F
-#define LETTER_I	0x04
-#define LETTER_T	0x78
-#define LETTER_X	0x76
-#define LETTER_Y	0x6E
-#define LETTER__	0x40
+#include <string.h>
+
+// First and last character codes covered by the glyph table.
+#define GLYPH_FIRST		0x20
+#define GLYPH_LAST		0x5F
+
+// Port outputs for printable characters from 0x20 (space) to 0x5F (underscore).
+// Lowercase letters are mapped into the uppercase range and characters which
+// cannot be shown on a seven segment display are left blank.
+const UCHAR _glyphTable[GLYPH_LAST - GLYPH_FIRST + 1] PROGMEM =
+{
+	// SP    !     "     #     $     %     &     '     (     )     *     +     ,     -     .     /
+	0x00, 0x00, 0x22, 0x00, 0x00, 0x00, 0x00, 0x02, 0x39, 0x0F, 0x00, 0x00, 0x00, 0x40, 0x00, 0x52,
+	// 0     1     2     3     4     5     6     7     8     9     :     ;     <     =     >     ?
+	0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F, 0x00, 0x00, 0x00, 0x48, 0x00, 0x53,
+	// @     A     B     C     D     E     F     G     H     I     J     K     L     M     N     O
+	0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D, 0x76, 0x04, 0x1E, 0x75, 0x38, 0x54, 0x54, 0x3F,
+	// P     Q     R     S     T     U     V     W     X     Y     Z     [     \     ]     ^     _
+	0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x1C, 0x00, 0x76, 0x6E, 0x5B, 0x39, 0x64, 0x0F, 0x23, 0x08
+};
 
 // Define port output for SSD decimal indicator.
 #define DECIMAL_POINT	0x80
 
+// Size of the frame which holds both blink "on" and blink "off" port outputs.
+#define FRAME_SIZE		(SSD_SIZE * 2)
+
 UCHAR _editSegment = TRUE;
-UCHAR _editBlink = TRUE;
+UCHAR _activeSegment = 0;
+
+// Front and back frames. Each frame holds blink "on" outputs followed by 
+// blink "off" outputs, so blinking is just a change of the frame offset.
+UCHAR _segmentFrames[2][FRAME_SIZE];
+UCHAR* volatile _frontFrame = _segmentFrames[0];
+UCHAR* volatile _backFrame = _segmentFrames[1];
+volatile UCHAR _frameReady = FALSE;
+volatile UCHAR _blinkOffset = 0;
+
+// Copy of the last rendered content to detect display buffer changes.
+DISPLAY _renderedDisplay;
+UCHAR _displayDirty = TRUE;
 
 /*************************************************************************
  Set currently active seven segment.
@@ -55,7 +65,11 @@ UCHAR _editBlink = TRUE;
 *************************************************************************/
 VOID setEditSegment(UCHAR segmentId)
 {
-	_editSegment = segmentId;
+	if(_editSegment != segmentId)
+	{
+		_editSegment = segmentId;
+		_displayDirty = TRUE;
+	}
 }
 
 /*************************************************************************
@@ -67,132 +81,115 @@ VOID setEditSegment(UCHAR segmentId)
 *************************************************************************/
 VOID setBlickState(UCHAR isActive)
 {
-	_editBlink = isActive;
+	// Switch between blink "on" and blink "off" outputs of the front frame.
+	_blinkOffset = (isActive == TRUE) ? 0 : SSD_SIZE;
 }
 
 /*************************************************************************
- Set display of the active seven segment display. 
+ Get seven segment port output for the specified display value.
 
- displayValue: Value to display on the seven segment display.
-
- isDeimal: set to TRUE / FALSE to activate the decimal indicator of the 
-           seven segment display.
+ displayValue: Value to display. 0 to 9 are treated as numbers and other
+			   values are treated as ASCII characters.
  
- Return: None
+ Return: Port output of the seven segment display.
 *************************************************************************/
-VOID setDIsplaySegment(UCHAR displayValue, UCHAR isDeimal)
+UCHAR charToSegment(UCHAR displayValue)
 {
-	switch(displayValue)	
+	// Numeric values are mapped into the ASCII digit range.
+	if(displayValue < 10)
+	{
+		displayValue += '0';
+	}
+	// Lowercase letters share the glyphs of the uppercase letters.
+	else if((displayValue >= 'a') && (displayValue <= 'z'))
 	{
-		// Digit mapping from 0 to 9.
-		case 0x00:
-			PORTD = DIGIT_0;
-			break;
-		case 0x01:
-			PORTD = DIGIT_1;
-			break;
-		case 0x02:
-			PORTD = DIGIT_2;
-			break;
-		case 0x03:
-			PORTD = DIGIT_3;
-			break;
-		case 0x04:
-			PORTD = DIGIT_4;
-			break;
-		case 0x05:
-		case 0x53:
-			PORTD = DIGIT_5;
-			break;
-		case 0x06:
-			PORTD = DIGIT_6;
-			break;
-		case 0x07:
-			PORTD = DIGIT_7;
-			break;
-		case 0x08:
-			PORTD = DIGIT_8;
-			break;
-		case 0x09:
-			PORTD = DIGIT_9;
-			break;
-			
-		// Start English letter mappings.
-		case 0x0A:
-		case 0x44:
-			PORTD = LETTER_D;
-			break;
-		case 0x45:
-		case 0x0B:
-			PORTD = LETTER_E;
-			break;
-		case 0x46:
-		case 0x0C:
-			PORTD = LETTER_F;
-			break;
-		case 0x49:
-		case 0x0D:
-			PORTD = LETTER_I;
-			break;
-		case 0x4E:
-		case 0x0E:
-		case 0x4D:
-			PORTD = LETTER_N;
-			break;
-		case 0x0F:
-		case 0x4F:
-			PORTD = LETTER_O;
-			break;
-		case 0x10:
-		case 0x54:
-			PORTD = LETTER_T;
-			break;
-		case 0x11:
-		case 0x58:
-			PORTD = LETTER_X;
-			break;
-		case 0x12:
-		case 0x59:
-			PORTD = LETTER_Y;
-			break;
-		case 0x13:
-		case 0x2D:
-			PORTD = LETTER__;
-			break;
-			
-		// For other values lets clear the segment.
-		default:
-			PORTD = 0x00;	
+		displayValue -= ('a' - 'A');
 	}
 	
-	// Check to activate decimal indicator of the seven segment display.
-	if(isDeimal)
+	// For other values lets clear the segment.
+	if((displayValue < GLYPH_FIRST) || (displayValue > GLYPH_LAST))
 	{
-		PORTD |= DECIMAL_POINT;
+		return 0x00;
 	}
+	
+	return pgm_read_byte(&_glyphTable[displayValue - GLYPH_FIRST]);
 }
 
 /*************************************************************************
- Set display of the complete seven segment display module. 
-
- valueSet: Instance of the display data structure.
+ Render specified display buffer into the back frame and queue it for 
+ display. Rendering is skipped if the content and the edit segment are 
+ not changed since the last call.
 
+ displayInfo: Instance of the display data structure.
+ 
  Return: None
 *************************************************************************/
-VOID setDisplayValueSet(PDISPLAY displayInfo)
+VOID renderDisplay(PDISPLAY displayInfo)
 {
-	UCHAR segmentId = 0;
+	UCHAR segmentId;
+	UCHAR segmentValue;
+	PUCHAR frame;
+	
+	if((_displayDirty == FALSE) && (memcmp(displayInfo, &_renderedDisplay, sizeof(DISPLAY)) == 0))
+	{
+		return;
+	}
+	
+	_renderedDisplay = *displayInfo;
+	_displayDirty = FALSE;
+	
+	// Withdraw any pending frame, the ISR does not swap frames until it is ready again.
+	_frameReady = FALSE;
+	frame = _backFrame;
 	
 	for(segmentId = 0; segmentId < SSD_SIZE; segmentId++)
 	{
-		setDIsplaySegment(displayInfo->valueBuffer[segmentId], (displayInfo->decimalPoint == segmentId));
-		if((_editSegment != segmentId) || (_editBlink == TRUE))
+		segmentValue = charToSegment(displayInfo->valueBuffer[segmentId]);
+		
+		// Check to activate decimal indicator of the seven segment display.
+		if(displayInfo->decimalPoint == segmentId)
 		{
-			PORTC = (PORTC & 0xF0) | 1 << segmentId ;
+			segmentValue |= DECIMAL_POINT;
 		}
 		
-		_delay_us(400);
-		PORTC = 0x00;
+		// Blink "off" outputs keep the edit segment dark.
+		frame[segmentId] = segmentValue;
+		frame[segmentId + SSD_SIZE] = (_editSegment == segmentId) ? 0x00 : segmentValue;
+	}
+	
+	_frameReady = TRUE;
+}
+
+/*************************************************************************
+ Advance seven segment display multiplexer by one digit. This function
+ is called on every system tick and it lights exactly one digit per call,
+ so the complete display is refreshed after SSD_SIZE ticks. Port outputs
+ are taken from the front frame prepared by renderDisplay.
+
+ Return: None
+*************************************************************************/
+VOID setDisplayValueSet()
+{
+	PUCHAR frame;
+	
+	// Swap frames only at the beginning of a refresh cycle to avoid tearing.
+	if((_activeSegment == 0) && (_frameReady == TRUE))
+	{
+		frame = _frontFrame;
+		_frontFrame = _backFrame;
+		_backFrame = frame;
+		_frameReady = FALSE;
+	}
+	
+	// Shutdown previous digit before changing the segment outputs to avoid ghosting.
+	HAL_DISPLAY_BLANK();
+	HAL_DISPLAY_SEGMENTS(_frontFrame[_blinkOffset + _activeSegment]);
+	HAL_DISPLAY_DIGIT(_activeSegment);
+	
+	// Move to next digit of the display.
+	if((++_activeSegment) >= SSD_SIZE)
+	{
+		_activeSegment = 0;
 	}
 }
 
@@ -217,6 +214,42 @@ VOID textToDisplay(UCHAR c1, UCHAR c2, UCHAR c3, UCHAR c4, PDISPLAY dataBuffer)
 	dataBuffer->valueBuffer[3] = c4;
 }
 
+/*************************************************************************
+ Fill display buffer with specified number. Number is right aligned and 
+ leading zeros are blanked. Numbers above 9999 are shown as 9999.
+
+ value: Number to show.
+ 
+ decimalPoint: Position of the decimal indicator or 0xFF to disable it.
+ 
+ dataBuffer: Instance of the display data structure to fill.
+ 
+ Return: None
+*************************************************************************/
+VOID numberToDisplay(UINT value, UCHAR decimalPoint, PDISPLAY dataBuffer)
+{
+	CHAR segmentId;
+	
+	if(value > 9999)
+	{
+		value = 9999;
+	}
+	
+	dataBuffer->decimalPoint = decimalPoint;
+	
+	for(segmentId = (SSD_SIZE - 1); segmentId >= 0; segmentId--)
+	{
+		dataBuffer->valueBuffer[segmentId] = value % 10;
+		value /= 10;
+	}
+	
+	// Blank leading zeros up to the digit with the decimal indicator.
+	for(segmentId = 0; (segmentId < (SSD_SIZE - 1)) && (segmentId < decimalPoint) && (dataBuffer->valueBuffer[segmentId] == 0); segmentId++)
+	{
+		dataBuffer->valueBuffer[segmentId] = 0xFF;
+	}
+}
+
 /*************************************************************************
  Clear value content of the specified display buffer. 
 
@@ -16,10 +16,16 @@
 
 #define NO_EDIT_SEGMENT 0xFF
 
-VOID setDIsplaySegment(UCHAR displayValue, UCHAR isDeimal);
-VOID setDisplayValueSet(PDISPLAY displayInfo);
+// Full frame refresh rate of the seven segment display in Hz. Display is
+// multiplexed by the system tick, one digit per tick.
+#define SSD_REFRESH_RATE	100
+
+UCHAR charToSegment(UCHAR displayValue);
+VOID renderDisplay(PDISPLAY displayInfo);
+VOID setDisplayValueSet();
 
 VOID textToDisplay(UCHAR c1, UCHAR c2, UCHAR c3, UCHAR c4, PDISPLAY dataBuffer);
+VOID numberToDisplay(UINT value, UCHAR decimalPoint, PDISPLAY dataBuffer);
 VOID clearDisplay(PUCHAR valueSet, UCHAR valueSize);
 
 VOID setEditSegment(UCHAR segmentId);
@@ -0,0 +1,202 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     eventmodule.c
+* Info:		System event and MCU sleep related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "eventmodule.h"
+#include "halmodule.h"
+
+#if WORK_LATENCY_STATS
+#include "timermodule.h"
+#endif
+
+volatile UCHAR _pendingEvents = 0;
+
+// Deferred work handlers and the pending work flags.
+VOID (*_workHandlers[WORK_COUNT])(VOID);
+volatile UCHAR _pendingWork = 0;
+
+#if WORK_LATENCY_STATS
+
+// Post time and the worst-case latency of each work item in microseconds.
+UINT32 _workPostTime[WORK_COUNT];
+UINT _workMaxLatency[WORK_COUNT];
+
+#endif
+
+/*************************************************************************
+ Post system event(s). This function should be called from interrupt 
+ service routines (or with interrupts disabled).
+
+ eventMask: Event flag(s) to post.
+ 
+ Return: None
+*************************************************************************/
+VOID postEvent(UCHAR eventMask)
+{
+	_pendingEvents |= eventMask;
+}
+
+/*************************************************************************
+ Wait for the specified system event(s). MCU stays in Idle sleep mode 
+ until at least one of the requested events is posted.
+
+ eventMask: Event flag(s) to wait for.
+ 
+ Return: Received event flag(s). Returned events are cleared from the 
+		 pending event list.
+*************************************************************************/
+UCHAR waitForEvent(UCHAR eventMask)
+{
+	UCHAR events;
+	
+	while(1)
+	{
+		// Complete deferred work before going to sleep.
+		runPendingWork();
+		
+		cli();
+		
+		events = _pendingEvents & eventMask;
+		if(events)
+		{
+			_pendingEvents &= ~events;
+			sei();
+			return events;
+		}
+		
+		// Work posted after runPendingWork.
+		if(_pendingWork)
+		{
+			sei();
+			continue;
+		}
+		
+		// SEI guarantees execution of the next instruction, so no event can 
+		// slip in between the above check and the sleep instruction.
+		HAL_SLEEP();
+	}
+}
+
+/*************************************************************************
+ Register handler of the deferred work item.
+
+ workId: Work item ID (WORK_xxx).
+ 
+ handler: Function to execute the work in main loop context.
+ 
+ Return: None
+*************************************************************************/
+VOID registerWork(UCHAR workId, VOID (*handler)(VOID))
+{
+	_workHandlers[workId] = handler;
+}
+
+/*************************************************************************
+ Post deferred work item. Work is executed in main loop context before 
+ the MCU goes to sleep. This function can be called from interrupt 
+ service routines.
+
+ workId: Work item ID (WORK_xxx).
+ 
+ Return: None
+*************************************************************************/
+VOID postWork(UCHAR workId)
+{
+	UCHAR sreg = SREG;
+	
+	cli();
+	
+#if WORK_LATENCY_STATS
+	if(!(_pendingWork & (1 << workId)))
+	{
+		_workPostTime[workId] = getTimerMicroseconds();
+	}
+#endif
+	
+	_pendingWork |= (1 << workId);
+	SREG = sreg;
+}
+
+/*************************************************************************
+ Execute all the pending deferred work items in priority order. Global 
+ interrupts are enabled while the work handlers are running.
+
+ Return: None
+*************************************************************************/
+VOID runPendingWork()
+{
+	UCHAR workId;
+	UCHAR workMask;
+#if WORK_LATENCY_STATS
+	UINT32 latency;
+#endif
+	
+	while(1)
+	{
+		cli();
+		
+		if(_pendingWork == 0)
+		{
+			sei();
+			return;
+		}
+		
+		// Lowest work ID has the highest priority.
+		workId = 0;
+		workMask = 0x01;
+		while(!(_pendingWork & workMask))
+		{
+			workId++;
+			workMask <<= 1;
+		}
+		
+		_pendingWork &= ~workMask;
+		
+#if WORK_LATENCY_STATS
+		latency = getTimerMicroseconds() - _workPostTime[workId];
+		if(latency > 0xFFFF)
+		{
+			latency = 0xFFFF;
+		}
+		
+		if(latency > _workMaxLatency[workId])
+		{
+			_workMaxLatency[workId] = (UINT)latency;
+		}
+#endif
+		
+		sei();
+		_workHandlers[workId]();
+	}
+}
+
+#if WORK_LATENCY_STATS
+
+/*************************************************************************
+ Get worst-case latency of the deferred work item.
+
+ workId: Work item ID (WORK_xxx).
+ 
+ Return: Worst-case latency in microseconds (limited to 65535).
+*************************************************************************/
+UINT getWorkLatency(UCHAR workId)
+{
+	UINT latency;
+	UCHAR sreg = SREG;
+	
+	cli();
+	latency = _workMaxLatency[workId];
+	SREG = sreg;
+	
+	return latency;
+}
+
+#endif
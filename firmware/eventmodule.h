@@ -0,0 +1,59 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     eventmodule.h
+* Info:		System event and MCU sleep related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef EVENT_MODULE_HEADER
+#define EVENT_MODULE_HEADER
+
+// System event flags posted by the interrupt service routines.
+#define EVENT_TICK		0x01
+#define EVENT_INPUT		0x02
+#define EVENT_RTC		0x04
+
+#define EVENT_ALL		(EVENT_TICK | EVENT_INPUT | EVENT_RTC)
+
+// Time between EVENT_TICK events in milliseconds.
+#define EVENT_TICK_PERIOD	65
+
+// Worst-case wake latency:
+// MCU use Idle sleep mode, so all the timers keep running and the CPU 
+// resumes from any enabled interrupt within 4 clock cycles plus the 
+// interrupt response time (4 cycles), ~2us at 4 MHz. Push buttons are 
+// debounced in the system tick ISR, so EVENT_INPUT is posted 4 system 
+// ticks (4 / (SSD_REFRESH_RATE * SSD_SIZE) = 10 ms) after a button 
+// change. EVENT_TICK is posted every 65 ms by a software timer and 
+// EVENT_RTC follows every software clock tick (1 Hz).
+
+// Deferred work items. Lower work ID has higher priority, and a work item
+// posted several times before it runs is executed only once.
+#define WORK_CLOCK		0
+#define WORK_NVRAM		1
+#define WORK_TWI		2
+
+#define WORK_COUNT		3
+
+// Set to 1 to measure the worst-case latency between posting a work item 
+// and the start of its execution.
+#ifndef WORK_LATENCY_STATS
+#define WORK_LATENCY_STATS	0
+#endif
+
+VOID postEvent(UCHAR eventMask);
+UCHAR waitForEvent(UCHAR eventMask);
+
+VOID registerWork(UCHAR workId, VOID (*handler)(VOID));
+VOID postWork(UCHAR workId);
+VOID runPendingWork();
+
+#if WORK_LATENCY_STATS
+UINT getWorkLatency(UCHAR workId);
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     halavr.h
+* Info:		ATmega8 backend of the hardware abstraction layer.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef HAL_AVR_HEADER
+#define HAL_AVR_HEADER
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+#include <util/delay.h>
+#include <compat/twi.h>
+
+// System control. HAL_SLEEP enables global interrupts and enters Idle 
+// sleep mode. HAL_WAIT is the body of the busy wait loops.
+#define HAL_SLEEP()					do { set_sleep_mode(SLEEP_MODE_IDLE); sleep_enable(); sei(); sleep_cpu(); sleep_disable(); } while(0)
+#define HAL_WAIT()					do { } while(0)
+#define HAL_DELAY_US(us)			_delay_us(us)
+#define HAL_RESET_CAUSE()			(MCUCSR)
+#define HAL_CLEAR_RESET_CAUSE()		(MCUCSR = 0x00)
+#define HAL_WDT_ENABLE()			wdt_enable(WDTO_2S)
+#define HAL_WDT_RESET()				wdt_reset()
+
+// Crystal oscillator start-up time in microseconds, 16K CK with the BOD 
+// enabled fuse setting (CKSEL = 1111, SUT = 01). It elapses before the 
+// first instruction, so it is added to the measured boot time.
+#define HAL_STARTUP_TIME			((16384UL * 1000000UL) / F_CPU)
+
+// Ports. Seven segment display: segments on PORTD and digit selection on 
+// PC0..PC3. Push buttons on PB0..PB2 (active low), master light on PB3 
+// and sleep LED on PB4.
+#define HAL_INIT_PORTS()			do { ADCSRA = 0x00; DDRD = 0xFF; DDRC = 0xFF; DDRB = 0xF8; PORTD = 0x00; PORTC = 0x00; PORTB = 0x07; } while(0)
+#define HAL_DISPLAY_BLANK()			(PORTC &= 0xF0)
+#define HAL_DISPLAY_SEGMENTS(s)		(PORTD = (s))
+#define HAL_DISPLAY_DIGIT(d)		(PORTC |= (1 << (d)))
+#define HAL_BUTTON_STATE()			((UCHAR)~PINB)
+#define HAL_LIGHT_ON()				(PORTB |= (1 << PB3))
+#define HAL_LIGHT_OFF()				(PORTB &= ~(1 << PB3))
+#define HAL_SLEEP_LED_ON()			(PORTB |= (1 << PB4))
+#define HAL_SLEEP_LED_OFF()			(PORTB &= ~(1 << PB4))
+
+// System tick: timer1 in CTC mode with prescaler 8 (CS11).
+#define HAL_TICK_INIT(compare)		do { TCNT1 = 0; OCR1A = (compare); TCCR1B = (1 << WGM12) | (1 << CS11); TIMSK |= (1 << OCIE1A); } while(0)
+#define HAL_TICK_COUNT()			(TCNT1)
+#define HAL_TICK_PENDING()			(TIFR & (1 << OCF1A))
+
+// Master light PWM: timer2 in fast PWM mode with prescaler 8 (CS21), 
+// output on OC2 (PB3).
+#define HAL_PWM_INIT()				do { OCR2 = 0; TCNT2 = 0; TCCR2 = (1 << WGM20) | (1 << WGM21) | (1 << CS21); } while(0)
+#define HAL_PWM_SET(duty)			do { OCR2 = (duty); TCCR2 |= (1 << COM21); } while(0)
+#define HAL_PWM_OFF()				(TCCR2 &= ~(1 << COM21))
+
+// Profiler time reference: free running timer0 with prescaler 8 (CS01).
+#define HAL_PROFILE_TIMER_INIT()	do { TCNT0 = 0; TCCR0 = (1 << CS01); } while(0)
+#define HAL_PROFILE_TIMER_COUNT()	(TCNT0)
+
+// TWI. Bus recovery drives SDA (PC4) and SCL (PC5) as open drain outputs 
+// (low by setting the DDR bit) with the external pull-ups.
+#define HAL_TWI_INIT(bitRate)		do { TWSR = 0; TWBR = (bitRate); TWCR = (1 << TWEN); } while(0)
+#define HAL_TWI_CONTROL(c)			(TWCR = (c))
+#define HAL_TWI_IS_STOPPING()		(TWCR & (1 << TWSTO))
+#define HAL_TWI_STATUS()			(TW_STATUS)
+#define HAL_TWI_WRITE(d)			(TWDR = (d))
+#define HAL_TWI_READ()				(TWDR)
+#define HAL_TWI_RELEASE_PINS()		do { PORTC &= ~((1 << PC4) | (1 << PC5)); DDRC &= ~((1 << PC4) | (1 << PC5)); } while(0)
+#define HAL_TWI_SDA_LOW()			(DDRC |= (1 << PC4))
+#define HAL_TWI_SDA_RELEASE()		(DDRC &= ~(1 << PC4))
+#define HAL_TWI_SCL_LOW()			(DDRC |= (1 << PC5))
+#define HAL_TWI_SCL_RELEASE()		(DDRC &= ~(1 << PC5))
+#define HAL_TWI_SDA_STATE()			(PINC & (1 << PC4))
+
+// EEPROM. Blocking reads, and the byte level access used by the EE_RDY 
+// interrupt driven writer.
+#define HAL_EEPROM_SIZE				(E2END + 1)
+#define HAL_EEPROM_READ_BYTE(a)		eeprom_read_byte((const UCHAR*)(a))
+#define HAL_EEPROM_READ_BLOCK(b, a, n)	eeprom_read_block((b), (const VOID*)(a), (n))
+#define HAL_EEPROM_GET(a)			(EEAR = (a), EECR |= (1 << EERE), EEDR)
+#define HAL_EEPROM_PUT(d)			do { EEDR = (d); EECR |= (1 << EEMWE); EECR |= (1 << EEWE); } while(0)
+#define HAL_EEPROM_IRQ_ENABLE()		(EECR |= (1 << EERIE))
+#define HAL_EEPROM_IRQ_DISABLE()	(EECR &= ~(1 << EERIE))
+#define HAL_EEPROM_IRQ_ACTIVE()		(EECR & (1 << EERIE))
+
+// Statically allocated RAM starts at RAMSTART.
+#define HAL_RAM_START				RAMSTART
+
+#endif
@@ -0,0 +1,25 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     halmodule.h
+* Info:		Hardware abstraction layer.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef HAL_MODULE_HEADER
+#define HAL_MODULE_HEADER
+
+// Firmware modules access the ports, timers, TWI, EEPROM and the system 
+// control registers only through the HAL_xxx macros. AVR backend maps the 
+// macros directly to the ATmega8 registers. Host backend (HAL_HOST) maps 
+// them to the peripheral models of the simulator.
+#ifdef HAL_HOST
+#include "halhost.h"
+#else
+#include "halavr.h"
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     inputmodule.c
+* Info:		Push button debounce and input event related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "displaymodule.h"
+#include "inputmodule.h"
+#include "halmodule.h"
+
+// Debounced button state (1 = pressed) and 2-bit vertical counter.
+UCHAR _buttonState = 0x00;
+UCHAR _counterLow = 0xFF;
+UCHAR _counterHigh = 0xFF;
+
+// Hold time of each button in samples.
+UINT _holdTime[BUTTON_COUNT];
+
+// Single producer (ISR) / single consumer (main loop) event queue.
+volatile UCHAR _eventQueue[INPUT_QUEUE_SIZE];
+volatile UCHAR _eventHead = 0;
+volatile UCHAR _eventTail = 0;
+
+/*************************************************************************
+ Add event into the input event queue. Events are dropped if the queue
+ is full.
+
+ inputEvent: Event type combined with the button flag.
+ 
+ Return: None
+*************************************************************************/
+VOID queueInputEvent(UCHAR inputEvent)
+{
+	UCHAR nextHead = (_eventHead + 1) & (INPUT_QUEUE_SIZE - 1);
+	
+	if(nextHead != _eventTail)
+	{
+		_eventQueue[_eventHead] = inputEvent;
+		_eventHead = nextHead;
+	}
+}
+
+/*************************************************************************
+ Sample and debounce the push buttons. This function should be called 
+ from the timer ISR at INPUT_SAMPLE_RATE. A button change is accepted 
+ after 4 consecutive stable samples.
+ 
+ Return: TRUE if new event(s) are added to the event queue, otherwise
+		 this function return FALSE.
+*************************************************************************/
+UCHAR sampleInputs()
+{
+	UCHAR changed;
+	UCHAR button;
+	UCHAR buttonId;
+	UCHAR lastHead = _eventHead;
+	
+	// Update vertical counters of the buttons which differ from the debounced state.
+	changed = _buttonState ^ (HAL_BUTTON_STATE() & BUTTON_MASK);
+	_counterLow = ~(_counterLow & changed);
+	_counterHigh = _counterLow ^ (_counterHigh & changed);
+	
+	// Toggle the buttons which are stable for 4 samples.
+	changed &= _counterLow & _counterHigh;
+	_buttonState ^= changed;
+	
+	for(buttonId = 0, button = BUTTON_OPTION; button & BUTTON_MASK; buttonId++, button <<= 1)
+	{
+		if(changed & button)
+		{
+			_holdTime[buttonId] = 0;
+			queueInputEvent(((_buttonState & button) ? INPUT_PRESS : INPUT_RELEASE) | button);
+		}
+		else if(_buttonState & button)
+		{
+			_holdTime[buttonId]++;
+			
+			if(INPUT_REPEAT_MASK & button)
+			{
+				// First repeat after INPUT_REPEAT_DELAY, then one repeat per INPUT_REPEAT_RATE.
+				if(_holdTime[buttonId] == INPUT_REPEAT_DELAY)
+				{
+					queueInputEvent(INPUT_REPEAT | button);
+					_holdTime[buttonId] = INPUT_REPEAT_DELAY - INPUT_REPEAT_RATE;
+				}
+			}
+			else if(_holdTime[buttonId] == INPUT_LONG_PRESS_TIME)
+			{
+				queueInputEvent(INPUT_LONG_PRESS | button);
+			}
+		}
+	}
+	
+	return (lastHead != _eventHead) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Get next event from the input event queue.
+ 
+ Return: Event type combined with the button flag, or INPUT_NONE if the 
+		 queue is empty.
+*************************************************************************/
+UCHAR getInputEvent()
+{
+	UCHAR inputEvent;
+	
+	if(_eventTail == _eventHead)
+	{
+		return INPUT_NONE;
+	}
+	
+	inputEvent = _eventQueue[_eventTail];
+	_eventTail = (_eventTail + 1) & (INPUT_QUEUE_SIZE - 1);
+	
+	return inputEvent;
+}
+
+/*************************************************************************
+ Discard all pending events in the input event queue.
+ 
+ Return: None
+*************************************************************************/
+VOID clearInputEvents()
+{
+	_eventTail = _eventHead;
+}
@@ -0,0 +1,50 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     inputmodule.h
+* Info:		Push button debounce and input event related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef INPUT_MODULE_HEADER
+#define INPUT_MODULE_HEADER
+
+// Push buttons connected to PB0, PB1 and PB2 (active low).
+#define BUTTON_OPTION	0x01
+#define BUTTON_UP		0x02
+#define BUTTON_DOWN		0x04
+#define BUTTON_MASK		(BUTTON_OPTION | BUTTON_UP | BUTTON_DOWN)
+#define BUTTON_COUNT	3
+
+// Input event types. Each event is combined with the related button flag.
+#define INPUT_NONE			0x00
+#define INPUT_PRESS			0x10
+#define INPUT_RELEASE		0x20
+#define INPUT_LONG_PRESS	0x40
+#define INPUT_REPEAT		0x80
+
+// Inputs are sampled on every display multiplexer tick (system tick).
+#define INPUT_SAMPLE_RATE	(SSD_REFRESH_RATE * SSD_SIZE)
+#define INPUT_MS_TO_SAMPLES(t)	((UINT)(((UINT32)(t) * INPUT_SAMPLE_RATE) / 1000))
+
+// Buttons in this mask generate auto-repeat events instead of long press event.
+#define INPUT_REPEAT_MASK	(BUTTON_UP | BUTTON_DOWN)
+
+// Hold time to generate long press event.
+#define INPUT_LONG_PRESS_TIME	INPUT_MS_TO_SAMPLES(1250)
+
+// Hold time to start auto-repeat and interval between auto-repeat events.
+#define INPUT_REPEAT_DELAY	INPUT_MS_TO_SAMPLES(500)
+#define INPUT_REPEAT_RATE	INPUT_MS_TO_SAMPLES(150)
+
+// Size of the input event queue. This value must be a power of 2.
+#define INPUT_QUEUE_SIZE	8
+
+UCHAR sampleInputs();
+UCHAR getInputEvent();
+VOID clearInputEvents();
+
+#endif
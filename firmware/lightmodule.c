@@ -0,0 +1,219 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     lightmodule.c
+* Info:		Master light PWM, dimming and fading related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "lightmodule.h"
+#include "timermodule.h"
+#include "halmodule.h"
+
+#if LIGHT_PWM_MODE
+
+// Gamma corrected (2.2) OCR2 values for each brightness level. Level 0 
+// disconnects OC2, all the other levels start from the narrowest pulse.
+const UCHAR _gammaTable[LIGHT_LEVELS] PROGMEM =
+{
+	0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x03, 0x04, 0x04, 0x05, 0x07, 0x08, 0x09, 0x0B,
+	0x0D, 0x0E, 0x10, 0x12, 0x14, 0x17, 0x19, 0x1C, 0x1F, 0x21, 0x24, 0x28, 0x2B, 0x2E, 0x32, 0x36,
+	0x39, 0x3D, 0x42, 0x46, 0x4A, 0x4F, 0x54, 0x59, 0x5E, 0x63, 0x69, 0x6E, 0x74, 0x7A, 0x80, 0x86,
+	0x8C, 0x93, 0x99, 0xA0, 0xA7, 0xAE, 0xB6, 0xBD, 0xC5, 0xCD, 0xD5, 0xDD, 0xE5, 0xEE, 0xF6, 0xFF
+};
+
+// Software timer used to step the fade.
+UCHAR _fadeTimer;
+
+VOID stepFade();
+
+#endif
+
+// Current and target brightness levels of the master light.
+volatile UCHAR _lightLevel = 0;
+volatile UCHAR _targetLevel = 0;
+UCHAR _lightBrightness = LIGHT_DEFAULT_LEVEL;
+UCHAR _lightState = FALSE;
+
+/*************************************************************************
+ Initialize master light output. In PWM mode timer2 is configured in 
+ fast PWM mode and the light is driven through OC2 (PB3). Timer module 
+ must be initialized before calling this function.
+
+ Return: None
+*************************************************************************/
+VOID initLightModule()
+{
+	HAL_LIGHT_OFF();
+	
+#if LIGHT_PWM_MODE
+	// Fast PWM mode with prescaler 8. OC2 stays disconnected while the light is off.
+	HAL_PWM_INIT();
+	
+	_fadeTimer = createTimer(stepFade);
+#endif
+}
+
+#if LIGHT_PWM_MODE
+
+/*************************************************************************
+ Set PWM duty cycle for the specified brightness level.
+
+ level: Brightness level from 0 to LIGHT_MAX_LEVEL.
+
+ Return: None
+*************************************************************************/
+VOID setPWMLevel(UCHAR level)
+{
+	if(level == 0)
+	{
+		// Disconnect OC2 to avoid the narrow pulse of fast PWM mode with OCR2 = 0.
+		HAL_PWM_OFF();
+	}
+	else
+	{
+		HAL_PWM_SET(pgm_read_byte(&_gammaTable[level]));
+	}
+}
+
+#endif
+
+/*************************************************************************
+ Fade master light to the specified brightness level. In PWM mode this 
+ function returns immediately and the fade runs in the fade timer.
+
+ level: Brightness level from 0 to LIGHT_MAX_LEVEL.
+
+ Return: None
+*************************************************************************/
+VOID fadeLight(UCHAR level)
+{
+#if LIGHT_PWM_MODE
+	UCHAR sreg = SREG;
+	
+	cli();
+	_targetLevel = level;
+	if((_lightLevel != _targetLevel) && (isTimerActive(_fadeTimer) == FALSE))
+	{
+		// Fade timer runs only while fading.
+		startTimer(_fadeTimer, LIGHT_FADE_STEP, TIMER_PERIODIC);
+	}
+	SREG = sreg;
+#else
+	_targetLevel = level;
+	_lightLevel = level;
+	
+	if(level)
+	{
+		HAL_LIGHT_ON();
+	}
+	else
+	{
+		HAL_LIGHT_OFF();
+	}
+#endif
+}
+
+/*************************************************************************
+ Turn master light on or off. Light fades to the configured brightness
+ level.
+
+ isActive: Set this parameter to TRUE to turn on the light.
+
+ Return: None
+*************************************************************************/
+VOID setLightState(UCHAR isActive)
+{
+	if(_lightState != isActive)
+	{
+		_lightState = isActive;
+		fadeLight((isActive == TRUE) ? _lightBrightness : 0);
+	}
+}
+
+/*************************************************************************
+ Turn master light on or off immediately without fading. This function 
+ is used to restore the last known light state during the system boot.
+
+ isActive: Set this parameter to TRUE to turn on the light.
+
+ Return: None
+*************************************************************************/
+VOID restoreLightState(UCHAR isActive)
+{
+	_lightState = isActive;
+	_targetLevel = (isActive == TRUE) ? _lightBrightness : 0;
+	_lightLevel = _targetLevel;
+	
+#if LIGHT_PWM_MODE
+	stopTimer(_fadeTimer);
+	setPWMLevel(_lightLevel);
+#else
+	if(_lightLevel)
+	{
+		HAL_LIGHT_ON();
+	}
+#endif
+}
+
+/*************************************************************************
+ Set brightness level used when the master light is on.
+
+ level: Brightness level from 1 to LIGHT_MAX_LEVEL.
+
+ Return: None
+*************************************************************************/
+VOID setLightBrightness(UCHAR level)
+{
+	_lightBrightness = (level > LIGHT_MAX_LEVEL) ? LIGHT_MAX_LEVEL : level;
+	
+	if(_lightState == TRUE)
+	{
+		fadeLight(_lightBrightness);
+	}
+}
+
+/*************************************************************************
+ Get current brightness level of the master light.
+
+ Return: Brightness level from 0 to LIGHT_MAX_LEVEL.
+*************************************************************************/
+UCHAR getLightLevel()
+{
+	return _lightLevel;
+}
+
+#if LIGHT_PWM_MODE
+
+/*************************************************************************
+ Fade timer callback. This timer runs only while the master light is 
+ fading, and it updates the PWM duty cycle by one level on every 
+ LIGHT_FADE_STEP milliseconds.
+ 
+ Return: None
+*************************************************************************/
+VOID stepFade()
+{
+	if(_lightLevel < _targetLevel)
+	{
+		_lightLevel++;
+	}
+	else if(_lightLevel > _targetLevel)
+	{
+		_lightLevel--;
+	}
+	
+	setPWMLevel(_lightLevel);
+	
+	// Fade is completed.
+	if(_lightLevel == _targetLevel)
+	{
+		stopTimer(_fadeTimer);
+	}
+}
+
+#endif
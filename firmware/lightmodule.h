@@ -0,0 +1,42 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     lightmodule.h
+* Info:		Master light PWM, dimming and fading related routines.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef LIGHT_MODULE_HEADER
+#define LIGHT_MODULE_HEADER
+
+// Set to 0 to switch the master light (PB3) without PWM.
+#ifndef LIGHT_PWM_MODE
+#define LIGHT_PWM_MODE	1
+#endif
+
+// Number of brightness levels in the gamma correction table.
+#define LIGHT_LEVELS		64
+#define LIGHT_MAX_LEVEL		(LIGHT_LEVELS - 1)
+
+// Brightness level used when the light is turned on.
+#define LIGHT_DEFAULT_LEVEL	LIGHT_MAX_LEVEL
+
+// Time to fade between off and full brightness in milliseconds.
+#define LIGHT_FADE_TIME		1500
+
+// Timer2 runs with prescaler 8 (CS21), which gives ~1.95 kHz PWM frequency.
+#define LIGHT_PWM_FREQUENCY	(F_CPU / 8 / 256)
+
+// Time between two fade steps in milliseconds.
+#define LIGHT_FADE_STEP		(LIGHT_FADE_TIME / LIGHT_MAX_LEVEL)
+
+VOID initLightModule();
+VOID setLightState(UCHAR isActive);
+VOID restoreLightState(UCHAR isActive);
+VOID setLightBrightness(UCHAR level);
+UCHAR getLightLevel();
+
+#endif
@@ -15,77 +15,143 @@
 #include "rtcmodule.h"
 #include "memmodule.h"
 #include "timemodule.h"
-
-#include <avr/io.h>
-#include <util/delay.h>	
-#include <avr/interrupt.h>
+#include "eventmodule.h"
+#include "inputmodule.h"
+#include "clockmodule.h"
+#include "schedulemodule.h"
+#include "lightmodule.h"
+#include "nvrammodule.h"
+#include "timermodule.h"
+#include "stackmodule.h"
+#include "watchdogmodule.h"
+#include "twimodule.h"
+#include "halmodule.h"
 
 INT main(VOID)
 {
-	UCHAR currentButtonState = 0x07;
-	UCHAR lastButtonState = 0x07;
-	UCHAR optionButtonCycles = 0;
+	UCHAR inputEvent;
+	UCHAR slotId;
+	UCHAR isRestored;
+	UCHAR isLightRestored;
+	TIME resetTime;
+#if PROFILE_ENABLE
+	UINT32 loopStart;
+	UINT32 loopTime;
+#endif
 	
 	initSystem();
 	
-	// Load user defined start and end time from EEPROM.
-	readTimeFromMemory(&_startTime, 0);
-	readTimeFromMemory(&_endTime, 4);
+#if PROFILE_ENABLE
+	initProfileModule();
+#endif
 	
-	// Check for valid start and end time.
-	IS_VALID_EEPROM_VALUE(_startTime.hours);
-	IS_VALID_EEPROM_VALUE(_startTime.minutes);
-	IS_VALID_EEPROM_VALUE(_startTime.seconds);
+	// Restore last known state of the master light from the EEPROM before 
+	// any RTC access. Schedule is confirmed by processClock on the first 
+	// valid time read.
+	isLightRestored = loadLightState(&_isLightActive);
+	if(isLightRestored == TRUE)
+	{
+		restoreLightState(_isLightActive);
+	}
 	
-	IS_VALID_EEPROM_VALUE(_endTime.hours);
-	IS_VALID_EEPROM_VALUE(_endTime.minutes);
-	IS_VALID_EEPROM_VALUE(_endTime.seconds);
+	_bootTime = (UINT)(getBootMicroseconds() / 100);
+	
+	// Load schedule and counters from RTC RAM. Light state of the RTC RAM is 
+	// used only if the EEPROM does not hold it yet.
+	isRestored = loadNVRAM(_startTime, _endTime);
+	if((isRestored == TRUE) && (isLightRestored == FALSE))
+	{
+		_isLightActive = getLastLightState();
+		restoreLightState(_isLightActive);
+		_bootTime = (UINT)(getBootMicroseconds() / 100);
+	}
+	
+	// If RTC RAM is not valid, load user defined start and end times of all 
+	// the schedule slots from the EEPROM journal (cold backup), or from the 
+	// legacy fixed EEPROM layout if the journal is empty.
+	if(isRestored == FALSE)
+	{
+		if(loadConfiguration(_startTime, _endTime) == FALSE)
+		{
+			for(slotId = 0; slotId < SCHEDULE_SLOTS; slotId++)
+			{
+				readTimeFromMemory(&_startTime[slotId], MEM_ON_TIME(slotId));
+				readTimeFromMemory(&_endTime[slotId], MEM_OFF_TIME(slotId));
+				
+				// Check for valid start and end time.
+				IS_VALID_EEPROM_VALUE(_startTime[slotId].hours);
+				IS_VALID_EEPROM_VALUE(_startTime[slotId].minutes);
+				IS_VALID_EEPROM_VALUE(_startTime[slotId].seconds);
+				
+				IS_VALID_EEPROM_VALUE(_endTime[slotId].hours);
+				IS_VALID_EEPROM_VALUE(_endTime[slotId].minutes);
+				IS_VALID_EEPROM_VALUE(_endTime[slotId].seconds);
+			}
+		}
+		
+		// Mirror loaded schedule into the RTC RAM.
+		saveScheduleToNVRAM(_startTime, _endTime);
+	}
+	
+	// Compile schedule slots into the minute-of-day activity map.
+	compileSchedule(_startTime, _endTime);
 	
 	while (1) 
     {
-		currentButtonState = (PINB & 0x07);
+		// Check in with the watchdog supervisor.
+		enterTask(TASK_MAIN);
+		
+#if PROFILE_ENABLE
+		loopStart = getTimerMicroseconds();
+#endif
+		inputEvent = getInputEvent();
 		
 		// Check for <option button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x01, lastButtonState))
+		if(inputEvent == (INPUT_PRESS | BUTTON_OPTION))
 		{
-			optionButtonCycles = 0;
 			_ssdMode = SSD_DISPLAY_TIME;
 			startSleepTimer();
 		}
 		
-		// Check for <up button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x02, lastButtonState))
+		// Check for <up button> press event. Repeated presses show next schedule slot.
+		if(inputEvent == (INPUT_PRESS | BUTTON_UP))
 		{
-			optionButtonCycles = 0;
+			_displaySlot = (_ssdMode == SSD_DISPLAY_START) ? ((_displaySlot + 1) % SCHEDULE_SLOTS) : 0;
 			_ssdMode = SSD_DISPLAY_START;
 			startSleepTimer();
 		}
 		
-		// Check for <down button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x04, lastButtonState))
+		// Check for <down button> press event. Repeated presses show next schedule slot.
+		if(inputEvent == (INPUT_PRESS | BUTTON_DOWN))
 		{
-			optionButtonCycles = 0;
+			_displaySlot = (_ssdMode == SSD_DISPLAY_END) ? ((_displaySlot + 1) % SCHEDULE_SLOTS) : 0;
 			_ssdMode = SSD_DISPLAY_END;
 			startSleepTimer();
 		}
 		
-		// Clear timer if system is idle for long time.
-		if(!_sleepTimer)
+		// Write default time into the RTC if it returns garbage values, or the
+		// software clock if the RTC oscillator is stopped. If the write fails, 
+		// the next time read requests the reset again.
+		if(_isClockReset == TRUE)
 		{
-			_ssdMode = SSD_DISPLAY_NONE;
+			_isClockReset = FALSE;
+			
+			cli();
+			resetTime = _sysTime;
+			sei();
+			
+			setSystemTime(&resetTime);
 		}
 		
-		// Count <option button> hold time.
-		if((currentButtonState & 0x01) == 0x00)
+		// Clear timer if system is idle for long time.
+		if(!_sleepTimer)
 		{
-			optionButtonCycles++;
+			_ssdMode = SSD_DISPLAY_NONE;
 		}
 		
 		// Long press of <option button> should open settings menu.
-		if(optionButtonCycles > LONG_PRESS_LIMIT)
+		if(inputEvent == (INPUT_LONG_PRESS | BUTTON_OPTION))
 		{
-			optionButtonCycles = 0;
-
 			updateSleepLED(FALSE);
 			showConfigurationOption();
 			
@@ -96,9 +162,8 @@ INT main(VOID)
 			setEditSegment(NO_EDIT_SEGMENT);
 			setBlickState(TRUE);
 			
-			// Reset button status.
-			currentButtonState = 0x07;
-			lastButtonState = currentButtonState;
+			// Discard input events generated while closing the menu.
+			clearInputEvents();
 			continue;
 		}
 		
@@ -116,20 +181,31 @@ INT main(VOID)
 				_displayBuffer.decimalPoint = 0xFF;
 				break;
 			case SSD_DISPLAY_START:
-				sysTimeToDisplayBuffer(&_startTime, &_displayBuffer);
+				sysTimeToDisplayBuffer(&_startTime[_displaySlot], &_displayBuffer);
 				updateSleepLED(FALSE);
 				_displayBuffer.decimalPoint = 0x01;
 				break;
 			case SSD_DISPLAY_END:
-				sysTimeToDisplayBuffer(&_endTime, &_displayBuffer);
+				sysTimeToDisplayBuffer(&_endTime[_displaySlot], &_displayBuffer);
 				updateSleepLED(FALSE);
 				_displayBuffer.decimalPoint = 0x01;
 				break;
 		}
 		
-		lastButtonState = currentButtonState;
+		renderDisplay(&_displayBuffer);
+		
+#if PROFILE_ENABLE
+		// Time stamps are taken with the 32-bit tick count, so an iteration 
+		// across the system tick wrap is measured correctly.
+		loopTime = getTimerMicroseconds() - loopStart;
+		recordProfile(PROFILE_MAIN_LOOP, (loopTime > 0xFFFF) ? 0xFFFF : (UINT)loopTime, PROFILE_NO_LATENCY);
+#endif
 		
-		_delay_ms(60);
+		// Sleep until timer tick, input event or RTC refresh.
+		if(inputEvent == INPUT_NONE)
+		{
+			waitForEvent(EVENT_ALL);
+		}
     }
 }
 
@@ -144,11 +220,11 @@ VOID updateSleepLED(UCHAR isActive)
 {
 	if((isActive == TRUE) && (_isLightActive == FALSE))
 	{
-		PORTB |= (1 << PB4);
+		HAL_SLEEP_LED_ON();
 	}
 	else
 	{
-		PORTB &= ~(1 << PB4);
+		HAL_SLEEP_LED_OFF();
 	}
 }
 
@@ -163,27 +239,28 @@ VOID editTimeValue(PTIME editBuffer)
 {
 	UCHAR editSegmentId = 0;
 	UCHAR tempSeconds;
-	UCHAR currentButtonState;
-	UCHAR lastButtonState = 0x07;
+	UCHAR inputEvent;
 	UCHAR maxNumber;
 	
 	// Activate edit mode in display buffer.
 	setEditSegment(editSegmentId);
-	_isBlink = TRUE;
 	_blinkState = TRUE;
+	startTimer(_blinkTimer, BLINK_PERIOD, TIMER_PERIODIC);
 	
 	// Set seconds to odd number to activate the decimal indicator.
 	tempSeconds = editBuffer->seconds;
 	editBuffer->seconds = 1;
 	sysTimeToDisplayBuffer(editBuffer, &_displayBuffer);
+	renderDisplay(&_displayBuffer);
 	
-	// Wait until user release the pushed button(s).
-	waitForButtonRelease();
+	// Ignore pending button events.
+	clearInputEvents();
 	startSleepTimer();
 	
 	while(1)
 	{
-		currentButtonState = (PINB & 0x07);
+		enterTask(TASK_MAIN);
+		inputEvent = getInputEvent();
 		
 		// Clear timer if system is idle for long time.
 		if(!_sleepTimer)
@@ -191,15 +268,14 @@ VOID editTimeValue(PTIME editBuffer)
 			// Exit edit mode without saving the changes.
 			setEditSegment(NO_EDIT_SEGMENT);
 			setBlickState(FALSE);
-			_blinkCounter = 0;
-			_isBlink = FALSE;
+			stopTimer(_blinkTimer);
 			// Restore the values of time data structure.
 			editBuffer->seconds = tempSeconds;
 			return;
 		}
 		
 		// Check for <option button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x01, lastButtonState))
+		if(inputEvent == (INPUT_PRESS | BUTTON_OPTION))
 		{
 			startSleepTimer();
 			
@@ -219,8 +295,7 @@ VOID editTimeValue(PTIME editBuffer)
 				// Exit edit mode.
 				setEditSegment(NO_EDIT_SEGMENT);
 				setBlickState(FALSE);
-				_blinkCounter = 0;
-				_isBlink = FALSE;
+				stopTimer(_blinkTimer);
 				// Update time structure with modified value.
 				editBuffer->hours = _displayBuffer.valueBuffer[1] + (_displayBuffer.valueBuffer[0] * 10);
 				editBuffer->minutes = _displayBuffer.valueBuffer[3] + (_displayBuffer.valueBuffer[2] * 10);
@@ -229,8 +304,8 @@ VOID editTimeValue(PTIME editBuffer)
 			}
 		}
 		
-		// Check for <up button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x02, lastButtonState))
+		// Check for <up button> press and auto-repeat events.
+		if((inputEvent == (INPUT_PRESS | BUTTON_UP)) || (inputEvent == (INPUT_REPEAT | BUTTON_UP)))
 		{
 			startSleepTimer();
 			
@@ -256,8 +331,8 @@ VOID editTimeValue(PTIME editBuffer)
 			}
 		}
 		
-		// Check for <down button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x04, lastButtonState))
+		// Check for <down button> press and auto-repeat events.
+		if((inputEvent == (INPUT_PRESS | BUTTON_DOWN)) || (inputEvent == (INPUT_REPEAT | BUTTON_DOWN)))
 		{
 			startSleepTimer();
 			
@@ -283,8 +358,13 @@ VOID editTimeValue(PTIME editBuffer)
 			}
 		}
 		
-		lastButtonState = currentButtonState;
-		_delay_ms(50);
+		renderDisplay(&_displayBuffer);
+		
+		// Sleep only if all the input events are processed.
+		if(inputEvent == INPUT_NONE)
+		{
+			waitForEvent(EVENT_TICK | EVENT_INPUT);
+		}
 	}
 }
 
@@ -296,20 +376,25 @@ VOID editTimeValue(PTIME editBuffer)
 VOID showConfigurationOption()
 {
 	MENU_MODE currentMode = SSD_MENU_TIME;
-	UCHAR currentButtonState;
-	UCHAR lastButtonState = 0x07;
+	UCHAR currentSlot = 0;
+	UCHAR inputEvent;
+	UCHAR isLongPress = FALSE;
+	UCHAR isTimeFailed = FALSE;
+	UCHAR isSaving = FALSE;
 
 	// Update display buffer with current mode (SSD_MENU_TIME).
 	textToDisplay('S','Y','S',' ', &_displayBuffer);
+	renderDisplay(&_displayBuffer);
 	
-	// Wait until user release the pushed button(s).
-	waitForButtonRelease();
+	// Ignore pending button events.
+	clearInputEvents();
 	startSleepTimer();
 	
 	// Start main service loop to handle options related activities.
 	while(1)
 	{
-		currentButtonState = (PINB & 0x07);
+		enterTask(TASK_MAIN);
+		inputEvent = getInputEvent();
 		
 		// Check for menu timeouts to clear the menu.
 		if(!_sleepTimer)
@@ -317,39 +402,79 @@ VOID showConfigurationOption()
 			return;
 		}
 		
+		// Menu is closed once the background writer stores the schedule. 
+		// Buttons are ignored while the record is being written.
+		if(isSaving == TRUE)
+		{
+			if(isMemoryBusy() == FALSE)
+			{
+				return;
+			}
+			
+			inputEvent = INPUT_NONE;
+		}
+		
+		// Error indicator of the time setup is cleared by the next button press.
+		if(inputEvent & INPUT_PRESS)
+		{
+			isTimeFailed = FALSE;
+		}
+		
 		// Check for <option button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x01, lastButtonState))
+		if(inputEvent == (INPUT_PRESS | BUTTON_OPTION))
 		{
 			startSleepTimer();
 			
 			switch(currentMode)
 			{
 				case SSD_MENU_TIME:
-					// Configure RTC with modified value.
+					// Configure RTC with modified value. Seconds start from zero.
 					editTimeValue(&_sysTime);
-					setSystemTime(&_sysTime);
+					_sysTime.seconds = 0;
+					isTimeFailed = (setSystemTime(&_sysTime) == FALSE) ? TRUE : FALSE;
 					break;
 				case SSD_MENU_ON_TIME:
-					editTimeValue(&_startTime);
-					saveTimeToMemory(&_startTime, 0);
+					editTimeValue(&_startTime[currentSlot]);
+					saveScheduleToNVRAM(_startTime, _endTime);
+					compileSchedule(_startTime, _endTime);
 					break;
 				case SSD_MENU_OFF_TIME:
-					editTimeValue(&_endTime);
-					saveTimeToMemory(&_endTime, 4);
+					editTimeValue(&_endTime[currentSlot]);
+					saveScheduleToNVRAM(_startTime, _endTime);
+					compileSchedule(_startTime, _endTime);
 					break;
 				case SSD_MENU_EXIT:
-					// Exit from options menu.
-					return;
+					// Exit is handled on button release.
+					break;
 			}
 			
-			// Reset button status.
-			currentButtonState = 0x07;
-			lastButtonState = currentButtonState;
 			continue;
 		}
 		
+		// Hidden diagnostics menu is opened by holding <option button> on the exit item.
+		if((inputEvent == (INPUT_LONG_PRESS | BUTTON_OPTION)) && (currentMode == SSD_MENU_EXIT))
+		{
+			showDiagnostics();
+			
+			// Ignore release of the button which opened or closed the diagnostics menu.
+			isLongPress = TRUE;
+		}
+		
+		// Release of <option button> on the exit item.
+		if((inputEvent == (INPUT_RELEASE | BUTTON_OPTION)) && (currentMode == SSD_MENU_EXIT))
+		{
+			if(isLongPress == FALSE)
+			{
+				// Save schedule into the EEPROM backup and exit from options menu.
+				saveConfiguration(_startTime, _endTime);
+				isSaving = TRUE;
+			}
+			
+			isLongPress = FALSE;
+		}
+		
 		// Check for <up button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x02, lastButtonState))
+		if(inputEvent == (INPUT_PRESS | BUTTON_UP))
 		{
 			startSleepTimer();
 			
@@ -357,12 +482,22 @@ VOID showConfigurationOption()
 			{
 				case SSD_MENU_TIME:
 					currentMode = SSD_MENU_ON_TIME;
+					currentSlot = 0;
 					break;
 				case SSD_MENU_ON_TIME:
 					currentMode = SSD_MENU_OFF_TIME;
 					break;
 				case SSD_MENU_OFF_TIME:
-					currentMode = SSD_MENU_EXIT;
+					// Move to on time of the next schedule slot.
+					if((currentSlot + 1) < SCHEDULE_SLOTS)
+					{
+						currentMode = SSD_MENU_ON_TIME;
+						currentSlot++;
+					}
+					else
+					{
+						currentMode = SSD_MENU_EXIT;
+					}
 					break;
 				case SSD_MENU_EXIT:
 					currentMode = SSD_MENU_TIME;
@@ -371,7 +506,7 @@ VOID showConfigurationOption()
 		}
 		
 		// Check for <down button> press event.
-		if(IS_BUTTON_PRESSED(currentButtonState, 0x04, lastButtonState))
+		if(inputEvent == (INPUT_PRESS | BUTTON_DOWN))
 		{
 			startSleepTimer();
 			
@@ -381,13 +516,23 @@ VOID showConfigurationOption()
 					currentMode = SSD_MENU_EXIT;
 					break;
 				case SSD_MENU_ON_TIME:
-					currentMode = SSD_MENU_TIME;
+					// Move to off time of the previous schedule slot.
+					if(currentSlot > 0)
+					{
+						currentMode = SSD_MENU_OFF_TIME;
+						currentSlot--;
+					}
+					else
+					{
+						currentMode = SSD_MENU_TIME;
+					}
 					break;
 				case SSD_MENU_OFF_TIME:
 					currentMode = SSD_MENU_ON_TIME;
 					break;
 				case SSD_MENU_EXIT:
 					currentMode = SSD_MENU_OFF_TIME;
+					currentSlot = SCHEDULE_SLOTS - 1;
 					break;
 			}
 		}
@@ -396,142 +541,521 @@ VOID showConfigurationOption()
 		switch(currentMode)
 		{
 			case SSD_MENU_TIME:
-				textToDisplay('S','Y','S',' ', &_displayBuffer);
+				if(isTimeFailed == TRUE)
+				{
+					textToDisplay('E','r','r',' ', &_displayBuffer);
+				}
+				else
+				{
+					textToDisplay('S','Y','S',' ', &_displayBuffer);
+				}
 				break;
 			case SSD_MENU_ON_TIME:
-				textToDisplay('O','N',' ',' ', &_displayBuffer);
+				textToDisplay('O','N',' ',(currentSlot + 1), &_displayBuffer);
 				break;
 			case SSD_MENU_OFF_TIME:
-				textToDisplay('O','F','F',' ', &_displayBuffer);
+				textToDisplay('O','F','F',(currentSlot + 1), &_displayBuffer);
 				break;
 			case SSD_MENU_EXIT:
-				textToDisplay(' ','-','-',' ', &_displayBuffer);
+				if(isSaving == TRUE)
+				{
+					textToDisplay('S','A','U','E', &_displayBuffer);
+				}
+				else
+				{
+					textToDisplay(' ','-','-',' ', &_displayBuffer);
+				}
 				break;
 		}
 		
-		lastButtonState = currentButtonState;
-		_delay_ms(50);
+		renderDisplay(&_displayBuffer);
+		
+		// Sleep only if all the input events are processed.
+		if(inputEvent == INPUT_NONE)
+		{
+			waitForEvent(EVENT_TICK | EVENT_INPUT);
+		}
+	}
+}
+
+/*************************************************************************
+ Fill display buffer with label or value of the diagnostics menu item.
+ 
+ itemId: Diagnostics menu item (DIAG_xxx).
+ 
+ isValue: TRUE to show the value, FALSE to show the label.
+ 
+ Return: None
+*************************************************************************/
+VOID diagnosticItemToDisplay(UCHAR itemId, UCHAR isValue)
+{
+	INT clockDrift;
+#if WORK_LATENCY_STATS
+	UINT workLatency;
+	UCHAR workId;
+#endif
+
+#if PROFILE_ENABLE
+	if(itemId >= DIAG_PROFILE)
+	{
+		profileItemToDisplay(itemId - DIAG_PROFILE, isValue, &_displayBuffer);
+		return;
+	}
+#endif
+	
+	if((itemId >= DIAG_FAULT_LOG) && (itemId <= DIAG_FAULT_LOG_END))
+	{
+		faultItemToDisplay(itemId - DIAG_FAULT_LOG, isValue);
+		return;
+	}
+	
+	switch(itemId)
+	{
+		case DIAG_BOOT_TIME:
+			// Reset to light output time in milliseconds.
+			if(isValue == TRUE)
+			{
+				numberToDisplay(_bootTime, 0x02, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('b','o','o','t', &_displayBuffer);
+			}
+			break;
+		case DIAG_STATIC_RAM:
+			// Size of the static data (.data and .bss) in bytes.
+			if(isValue == TRUE)
+			{
+				numberToDisplay(getStaticRAMSize(), 0xFF, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('S','t','A','t', &_displayBuffer);
+			}
+			break;
+		case DIAG_FREE_RAM:
+			// Minimum free RAM (stack headroom) since the system startup.
+			if(isValue == TRUE)
+			{
+				numberToDisplay(getFreeRAM(), 0xFF, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('F','r','E','E', &_displayBuffer);
+			}
+			break;
+		case DIAG_RESET_CAUSE:
+			// Reset flags of this startup: watchdog, brownout, external and power-on.
+			if(isValue == TRUE)
+			{
+				textToDisplay((getResetCause() >> WDRF) & 0x01, (getResetCause() >> BORF) & 0x01, (getResetCause() >> EXTRF) & 0x01, (getResetCause() >> PORF) & 0x01, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('r','S','t',' ', &_displayBuffer);
+			}
+			break;
+		case DIAG_TWI_ERRORS:
+			// Number of failed I2C transactions since the system startup.
+			if(isValue == TRUE)
+			{
+				numberToDisplay(getTWIErrorCount(), 0xFF, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('I','2','C',' ', &_displayBuffer);
+			}
+			break;
+		case DIAG_CLOCK_DRIFT:
+			// Software clock drift on the last RTC synchronization in seconds.
+			if(isValue == TRUE)
+			{
+				clockDrift = getClockDrift();
+				numberToDisplay((clockDrift < 0) ? -clockDrift : clockDrift, 0xFF, &_displayBuffer);
+				
+				if(clockDrift < 0)
+				{
+					_displayBuffer.valueBuffer[0] = '-';
+				}
+			}
+			else
+			{
+				textToDisplay('d','r','F','t', &_displayBuffer);
+			}
+			break;
+		case DIAG_LIGHT_COUNT:
+			// Number of master light activations stored in the RTC RAM.
+			if(isValue == TRUE)
+			{
+				numberToDisplay(getLightOnCount(), 0xFF, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('L','C','n','t', &_displayBuffer);
+			}
+			break;
+		case DIAG_LIGHT_HOURS:
+			// Total active time of the master light in hours.
+			if(isValue == TRUE)
+			{
+				numberToDisplay((getLightOnMinutes() / 60) > 9999 ? 9999 : (UINT)(getLightOnMinutes() / 60), 0xFF, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('L','H','r','S', &_displayBuffer);
+			}
+			break;
+#if WORK_LATENCY_STATS
+		case DIAG_WORK_LATENCY:
+			// Worst-case deferred work latency in milliseconds with two decimal 
+			// places (getWorkLatency returns microseconds, up to 65.53 ms).
+			if(isValue == TRUE)
+			{
+				workLatency = 0;
+				for(workId = 0; workId < WORK_COUNT; workId++)
+				{
+					if(getWorkLatency(workId) > workLatency)
+					{
+						workLatency = getWorkLatency(workId);
+					}
+				}
+				
+				numberToDisplay(workLatency / 10, 0x01, &_displayBuffer);
+			}
+			else
+			{
+				textToDisplay('L','A','t',' ', &_displayBuffer);
+			}
+			break;
+#endif
 	}
 }
 
 /*************************************************************************
- Interrupt service routine for Timer2. This timer is mainly used to call 
- RTC with specific intervals to update the system time.
+ Fill display buffer with label or value of the fault log item. Each 
+ fault record has two items: reset cause, and the uptime at the reset. 
+ Reset cause is shown as the task identifier followed by the watchdog, 
+ brownout and external reset flags, and the uptime is shown in hours.
+ 
+ itemId: Fault log item starting from 0 (newest record).
+ 
+ isValue: TRUE to show the value, FALSE to show the label.
  
  Return: None
 *************************************************************************/
-ISR(TIMER2_OVF_vect)
+VOID faultItemToDisplay(UCHAR itemId, UCHAR isValue)
 {
-	// Disable timer2 interrupt and start requesting data from RTC.
-	TIMSK &= ~( 1 << TOIE2);
+	FAULT_RECORD record;
+	UCHAR isUptime = itemId & 0x01;
+	
+	if(isValue == FALSE)
+	{
+		textToDisplay('F', (itemId >> 1) + 1, ' ', (isUptime ? 'u' : 'r'), &_displayBuffer);
+		return;
+	}
 	
-	if((++_rtcRefreshCounter) == 20)
+	if(readFaultRecord(itemId >> 1, &record) == FALSE)
 	{
-		getSystemTime(&_sysTime);
+		textToDisplay('-','-','-','-', &_displayBuffer);
+		return;
+	}
+	
+	if(isUptime)
+	{
+		numberToDisplay((record.uptime / 3600) > 9999 ? 9999 : (UINT)(record.uptime / 3600), 0xFF, &_displayBuffer);
+	}
+	else
+	{
+		textToDisplay((record.taskId == TASK_NONE) ? '-' : record.taskId, (record.resetCause >> WDRF) & 0x01, (record.resetCause >> BORF) & 0x01, (record.resetCause >> EXTRF) & 0x01, &_displayBuffer);
+		_displayBuffer.decimalPoint = 0x00;
+	}
+}
+
+/*************************************************************************
+ Function to handle hidden diagnostics menu. <up button> and <down 
+ button> select the item, <option button> toggles between the label and 
+ the value of the item, and holding <option button> closes the menu.
+ 
+ Return: None
+*************************************************************************/
+VOID showDiagnostics()
+{
+	UCHAR itemId = 0;
+	UCHAR isValue = FALSE;
+	UCHAR inputEvent;
+	
+	// Ignore pending button events.
+	clearInputEvents();
+	startSleepTimer();
+	
+	while(1)
+	{
+		enterTask(TASK_MAIN);
+		inputEvent = getInputEvent();
+		
+		// Check for menu timeouts to clear the menu.
+		if(!_sleepTimer)
+		{
+			return;
+		}
+		
+		// Long press of <option button> returns to the options menu.
+		if(inputEvent == (INPUT_LONG_PRESS | BUTTON_OPTION))
+		{
+			startSleepTimer();
+			return;
+		}
+		
+		// Check for <option button> press event.
+		if(inputEvent == (INPUT_PRESS | BUTTON_OPTION))
+		{
+			startSleepTimer();
+			isValue = ~isValue;
+		}
 		
-		// Check for light on condition.
-		_isLightActive = isLightActive(&_sysTime, &_startTime, &_endTime);
-		if(_isLightActive == TRUE)
+		// Check for <up button> press event.
+		if(inputEvent == (INPUT_PRESS | BUTTON_UP))
 		{
-			// Turn on master light.
-			PORTB |= (1 << PB3);
+			startSleepTimer();
+			itemId = ((itemId + 1) < DIAG_COUNT) ? (itemId + 1) : 0;
+			isValue = FALSE;
 		}
-		else 
+		
+		// Check for <down button> press event.
+		if(inputEvent == (INPUT_PRESS | BUTTON_DOWN))
 		{
-			// Turn off master light.
-			PORTB &= ~(1 << PB3);
+			startSleepTimer();
+			itemId = (itemId > 0) ? (itemId - 1) : (DIAG_COUNT - 1);
+			isValue = FALSE;
 		}
 		
-		_rtcRefreshCounter = 0;
+		// Values are updated on every tick.
+		diagnosticItemToDisplay(itemId, isValue);
+		renderDisplay(&_displayBuffer);
+		
+		// Sleep only if all the input events are processed.
+		if(inputEvent == INPUT_NONE)
+		{
+			waitForEvent(EVENT_TICK | EVENT_INPUT);
+		}
 	}
+}
+
+/*************************************************************************
+ Interrupt service routine for Timer1 compare match. This is the system 
+ tick (TIMER_TICK_RATE). It multiplexes the seven segment display, one 
+ digit per tick, samples the push buttons and runs the software timers.
+ 
+ Return: None
+*************************************************************************/
+ISR(TIMER1_COMPA_vect)
+{
+	UCHAR lastTask = enterTask(TASK_TICK);
 	
-	if(_isBlink == TRUE)
+	// Timer1 is cleared on compare match, so its count is the entry latency.
+	PROFILE_ISR_BEGIN(TIMER_TCNT_TO_US(HAL_TICK_COUNT()));
+	
+	// Light next digit of the seven segment display.
+	setDisplayValueSet();
+	
+	// Debounce push buttons and notify main loop about new input events.
+	if(sampleInputs() == TRUE)
 	{
-		if((++_blinkCounter) == 10)
-		{
-			_blinkState = ~_blinkState;
-			setBlickState(_blinkState);
-			_blinkCounter = 0;
-		}
+		postEvent(EVENT_INPUT);
 	}
 	
-	// Reset timer2 counter and enable the interrupt.
-	TIMSK |= (1 << TOIE2);
-	TCNT2 = 0;
+	runTimers();
+	
+	// Detect stuck I2C transaction, the bus is released by WORK_TWI.
+	checkTWITimeout();
+	
+	PROFILE_ISR_END(PROFILE_TICK);
+	leaveTask(lastTask);
 }
 
 /*************************************************************************
- Interrupt service routine for Timer0. This timer is used to update 
- seven segment display with display buffer content.
+ Software clock timer callback (1Hz). Advances the software clock and 
+ defers the rest of the clock processing to the main loop.
  
  Return: None
 *************************************************************************/
-ISR(TIMER0_OVF_vect)
+VOID onClockTick()
 {
-	// Disable timer0 interrupt and refresh seven segment display.
-	TIMSK &= ~( 1 << TOIE0);
+	updateUptime();
 	
-	// Update seven segment display based on current display buffer content.
-	setDisplayValueSet(&_displayBuffer);
+	if(tickSoftClock(&_sysTime) == TRUE)
+	{
+		_isSyncDue = TRUE;
+	}
 	
-	// Reset timer0 counter and enable the interrupt.
-	TIMSK |= (1 << TOIE0);
-	TCNT0 = 232;
+	postWork(WORK_CLOCK);
 }
 
 /*************************************************************************
- Interrupt service routine for Timer1. This timer is used to detect 
- system idle state.
+ Clock work handler. Synchronizes the software clock with RTC and drives 
+ the light control. This function runs in main loop context.
  
  Return: None
 *************************************************************************/
-ISR(TIMER1_OVF_vect)
+VOID processClock()
 {
-	// Disable timer1 interrupt and refresh seven segment display.
-	TIMSK &= ~( 1 << TOIE1);
+	TIME rtcTime;
+	UINT currentMinutes;
+	UCHAR sreg;
+	UCHAR isTimeRead;
+	UCHAR age;
+	UCHAR lastTask = enterTask(TASK_CLOCK);
+	
+	// Time of a stopped RTC is stale once the software clock runs. Software 
+	// clock is kept and written back into the RTC, which also restarts the 
+	// oscillator. Oscillator stopped before the first valid time read is 
+	// restarted from the RTC time.
+	isTimeRead = readSystemTime(&rtcTime);
+	if((isTimeRead == TRUE) && (isRTCHalted() == TRUE))
+	{
+		if(_isTimeValid == TRUE)
+		{
+			_isClockReset = TRUE;
+			isTimeRead = FALSE;
+		}
+		else
+		{
+			restartRTCOscillator();
+		}
+	}
+	
+	// Apply time received on the last RTC synchronization.
+	if(isTimeRead == TRUE)
+	{
+		sreg = SREG;
+		cli();
+		
+		if(IS_VALID_TIME(&rtcTime))
+		{
+			// RTC time is read when the request is submitted. It is advanced 
+			// by the software clock ticks elapsed since then.
+			for(age = getRTCReadAge(); age > 0; age--)
+			{
+				addSecond(&rtcTime);
+			}
+			
+			// Drift is measured only against a software clock which already 
+			// runs from a valid time.
+			if(_isTimeValid == TRUE)
+			{
+				syncSoftClock(&_sysTime, &rtcTime);
+			}
+			else
+			{
+				_sysTime = rtcTime;
+			}
+			
+			_isTimeValid = TRUE;
+		}
+		else if((getResetCause() & (1 << BORF)) == 0x00)
+		{
+			// RTC battery backup is failed. Reset time to 00:00:00, but ignore 
+			// garbage values on brownout resets (required to work with some PSUs).
+			_sysTime.hours = 0;
+			_sysTime.minutes = 0;
+			_sysTime.seconds = 0;
+			_isTimeValid = TRUE;
+			_isClockReset = TRUE;
+		}
+		
+		SREG = sreg;
+	}
 	
-	// Update sleep counter for display / menu timeouts.
-	if(_sleepTimer > 0)
+	// Start RTC read in background if synchronization is due. RTC is read on 
+	// every tick until the first valid time is received.
+	if((_isSyncDue == TRUE) || (_isTimeValid == FALSE))
 	{
-		_sleepTimer--;
+		_isSyncDue = FALSE;
+		requestSystemTime();
+	}
+	
+	// Check for light on condition. Master light fades in / out on state changes.
+	// Restored light state is kept until the system time is confirmed.
+	if(_isTimeValid == TRUE)
+	{
+		sreg = SREG;
+		cli();
+		currentMinutes = timeToMinutes(&_sysTime);
+		SREG = sreg;
 		
-		// Reset timer1 counter and enable the interrupt.
-		TIMSK |= (1 << TOIE1);
-		TCNT1 = 0;
+		_isLightActive = isLightActive(currentMinutes);
+		setLightState(_isLightActive);
+		postWork(WORK_NVRAM);
 	}
+	
+	postEvent(EVENT_RTC);
+	leaveTask(lastTask);
 }
 
 /*************************************************************************
- Enable sleep timer to determine system idle state.
+ RTC RAM work handler. Updates light state and usage counters in the 
+ RTC RAM, and the light state in the EEPROM. This function runs in main 
+ loop context.
  
  Return: None
 *************************************************************************/
-VOID startSleepTimer()
+VOID processNVRAM()
 {
-	_sleepTimer = SLEEP_TIMEOUT;
-	TIMSK |= (1 << TOIE1);
-	TCNT1 = 0;
+	UCHAR lastTask = enterTask(TASK_NVRAM);
+	
+	updateNVRAMState(_isLightActive);
+	saveLightState(_isLightActive);
+	leaveTask(lastTask);
 }
 
 /*************************************************************************
- Wait until user release the input button(s).
+ Blink timer callback. This timer runs only in edit mode and it blinks 
+ the edit segment.
  
  Return: None
 *************************************************************************/
-VOID waitForButtonRelease()
+VOID onBlinkTick()
 {
-	while(1)
-	{
-		if((PINB & 0x07) == 0x07)
-		{
-			_delay_ms(500);
-			break;
-		}
-		
-		_delay_ms(50);
-	}
+	_blinkState = ~_blinkState;
+	setBlickState(_blinkState);
+}
+
+/*************************************************************************
+ User interface timer callback. Generates periodic tick for the main loop
+ and user interface.
+ 
+ Return: None
+*************************************************************************/
+VOID onUITick()
+{
+	postEvent(EVENT_TICK);
+}
+
+/*************************************************************************
+ Idle timer callback. Marks the system as idle to clear the display and 
+ the menus.
+ 
+ Return: None
+*************************************************************************/
+VOID onIdleTimeout()
+{
+	_sleepTimer = 0;
+	postEvent(EVENT_TICK);
+}
+
+/*************************************************************************
+ Enable sleep timer to determine system idle state.
+ 
+ Return: None
+*************************************************************************/
+VOID startSleepTimer()
+{
+	UCHAR sreg = SREG;
 	
-	_delay_ms(150);
+	cli();
+	_sleepTimer = TRUE;
+	startTimer(_idleTimer, SLEEP_TIMEOUT, TIMER_ONE_SHOT);
+	SREG = sreg;
 }
 
 /*************************************************************************
@@ -542,73 +1066,61 @@ VOID waitForButtonRelease()
 *************************************************************************/
 VOID initSystem()
 {
-	// Shutdown unused peripherals of this MCU.
-	ADCSRA = 0x00;
+	// Shutdown unused peripherals, set PORTC and PORTD as an output ports 
+	// (mainly used for seven segment display) and set default state of the ports.
+	HAL_INIT_PORTS();
 	
-	// Set PORTC and PORTD as an output ports (mainly used for seven segment display).
-	DDRD = 0xFF;
-	DDRC = 0xFF;
-	DDRB = 0xF8;
+	// Start system tick (timer1). System tick is also used to measure the 
+	// boot time. Timer0 is not used.
+	initTimerModule();
 	
-	// Set default state of the ports.
-	PORTD = 0x00;
-	PORTC = 0x00;
-	PORTB = 0x07;
+	// Setup timer2 to drive the master light through OC2 (PB3).
+	initLightModule();
 	
-	// Enable timer0 with to handle button inputs.
-	TCNT0 = 232;
-	TCCR0 |= (1 << CS02);
-	
-	// Enable timer2 to handle RTC scans.
-	TCNT2 = 0;
-	TCCR2 |= (1 << CS22) | (1 << CS21) | (1 << CS22);
-	
-	// Enable timer1 with long time durations.
-	TCNT1 = 0;
-	TCCR1B |= (1 << CS12);
-	
-	_delay_ms(10);
-	
-	_rtcRefreshCounter = 0;
 	_ssdMode = SSD_DISPLAY_NONE;
 	
-	_blinkCounter = 0;
-	_isBlink = FALSE;
+	_blinkState = TRUE;
 	_sleepTimer = 0;
 	_isLightActive = FALSE;
+	_displaySlot = 0;
+	_isTimeValid = FALSE;
+	_isClockReset = FALSE;
+	_isSyncDue = FALSE;
 	
 	// Clear seven segment related data structures.
 	clearDisplay(_displayBuffer.valueBuffer, SSD_SIZE);
 	_displayBuffer.decimalPoint = 0xFF;
+	renderDisplay(&_displayBuffer);
 	
 	// Reset editor related parameters.
 	setEditSegment(NO_EDIT_SEGMENT);
 	setBlickState(TRUE);
 	
-	// Initialize I2C to communicate with DS1307 RTC.
+	sei();
+	
+	// Log the cause of the previous reset and start the watchdog timer.
+	initWatchdogModule();
+	
+	// Initialize I2C to communicate with DS1307 RTC. I2C driver is interrupt 
+	// driven, and the first time read runs in background.
 	initRTCModule();
-	_delay_ms(20);
+	requestSystemTime();
 	
-	// Make sure that RTC runs correctly. If RTC battery backup fails it returns
-	// garbage values, and this code block fix it by reset the RTC to 00:00:00.
-	getSystemTime(&_sysTime);
-	if((_sysTime.hours > 23) || (_sysTime.minutes > 59) || (_sysTime.seconds > 59))
-	{
-		// Ignore time setup on brownout resets. This check is required to work with some PSUs. 
-		if((MCUCSR & 0x04) == 0x00)
-		{
-			// Reset RTC time to 00:00:00.
-			_sysTime.hours = 0;
-			_sysTime.minutes = 0;
-			_sysTime.seconds = 0;
-					
-			setSystemTime(&_sysTime);
-			_delay_ms(20);
-		}
-	}
+	// Software clock is synchronized on the first valid time read.
+	initSoftClock();
 	
-	// Setup required interrupts.
-	TIMSK |= (1 << TOIE0) | (1 << TOIE2) | (1 << TOIE1);
-	sei();
+	// Setup deferred work handlers.
+	registerWork(WORK_CLOCK, processClock);
+	registerWork(WORK_NVRAM, processNVRAM);
+	registerWork(WORK_TWI, processTWITimeout);
+	
+	// Setup software timers.
+	_clockTimer = createTimer(onClockTick);
+	_blinkTimer = createTimer(onBlinkTick);
+	_uiTimer = createTimer(onUITick);
+	_idleTimer = createTimer(onIdleTimeout);
+	
+	startTimer(_clockTimer, CLOCK_TICK_PERIOD, TIMER_PERIODIC);
+	startTimer(_uiTimer, EVENT_TICK_PERIOD, TIMER_PERIODIC);
 }
 
@@ -13,33 +13,83 @@
 #define MAIN_HEADER
 
 #include "sysbasedef.h"
+#include "eventmodule.h"
+#include "profilemodule.h"
+#include "memmodule.h"
 
-#define LONG_PRESS_LIMIT	21
-#define SLEEP_TIMEOUT	5
+// Display / menu idle timeout in milliseconds.
+#define SLEEP_TIMEOUT	21000
+
+// Time between edit segment blink state changes in milliseconds.
+#define BLINK_PERIOD	165
 
-#define IS_BUTTON_PRESSED(s,p,l) (((s & p) == p) && (l & p) == 0x00)
 #define IS_VALID_EEPROM_VALUE(p) p=(p==0xFF)?0:p 
 
+// Items of the hidden diagnostics menu.
+enum diagItem
+{
+	DIAG_BOOT_TIME,
+	DIAG_STATIC_RAM,
+	DIAG_FREE_RAM,
+	DIAG_RESET_CAUSE,
+	DIAG_TWI_ERRORS,
+	DIAG_CLOCK_DRIFT,
+	DIAG_LIGHT_COUNT,
+	DIAG_LIGHT_HOURS,
+	DIAG_FAULT_LOG,
+	DIAG_FAULT_LOG_END = (DIAG_FAULT_LOG + (MEM_FAULT_LOG_SIZE * 2) - 1),
+#if WORK_LATENCY_STATS
+	DIAG_WORK_LATENCY,
+#endif
+#if PROFILE_ENABLE
+	DIAG_PROFILE,
+	DIAG_PROFILE_END = (DIAG_PROFILE + PROFILE_ITEM_COUNT - 1),
+#endif
+	DIAG_COUNT
+};
+
 // System wide data structures and variables.
 DISPLAY _displayBuffer;
 DISPLAY_MODE _ssdMode;
 TIME _sysTime;
-TIME _startTime;
-TIME _endTime;
+TIME _startTime[SCHEDULE_SLOTS];
+TIME _endTime[SCHEDULE_SLOTS];
 
-UCHAR _rtcRefreshCounter;
-UCHAR _blinkCounter;
-UCHAR _isBlink;
 UCHAR _blinkState;
-UCHAR _sleepTimer;
+volatile UCHAR _sleepTimer;
 UCHAR _isLightActive;
+UCHAR _displaySlot;
+
+// Software timers of the main module.
+UCHAR _clockTimer;
+UCHAR _blinkTimer;
+UCHAR _uiTimer;
+UCHAR _idleTimer;
+
+// Set after the first valid time is received from RTC.
+volatile UCHAR _isTimeValid;
+volatile UCHAR _isClockReset;
+
+// Set by the software clock when RTC synchronization is due.
+volatile UCHAR _isSyncDue;
+
+// Time from reset to restored light output in 0.1 ms units.
+UINT _bootTime;
 
 VOID initSystem();
-VOID waitForButtonRelease();
 VOID startSleepTimer();
+VOID onClockTick();
+VOID processClock();
+VOID processNVRAM();
+VOID onBlinkTick();
+VOID onUITick();
+VOID onIdleTimeout();
 VOID updateSleepLED(UCHAR isActive);
 
 VOID showConfigurationOption();
+VOID showDiagnostics();
+VOID diagnosticItemToDisplay(UCHAR itemId, UCHAR isValue);
+VOID faultItemToDisplay(UCHAR itemId, UCHAR isValue);
 VOID setupSystemTime();
 
 #endif
@@ -11,23 +11,110 @@
 
 #include "sysbasedef.h"
 #include "memmodule.h"
+#include "profilemodule.h"
+#include "halmodule.h"
 
-#include <avr/eeprom.h>
+#include <string.h>
+
+// Background EEPROM write queue, drained by the EE_RDY interrupt.
+MEM_WRITE _writeQueue[MEM_QUEUE_SIZE];
+volatile UCHAR _writeHead = 0;
+volatile UCHAR _writeTail = 0;
+
+// Index and sequence number of the newest valid journal record.
+UCHAR _journalIndex = 0;
+UINT _journalSequence = NO_SEQUENCE;
+
+// Light state value stored in the EEPROM.
+UCHAR _savedLightState = 0xFF;
 
 /*************************************************************************
- Write specified time data structure to EEPROM.
+ Queue single byte to write into the EEPROM in background. If the write 
+ queue is full, MCU sleeps until the EE_RDY interrupt frees a slot.
  
- timeInfo: Instance of the time data structure.
+ address: EEPROM address.
  
- offset: Memory address offset.
+ data: Byte to write.
+ 
+ Return: None
+*************************************************************************/
+VOID writeMemoryByte(UINT address, UCHAR data)
+{
+	UCHAR nextHead = (_writeHead + 1) % MEM_QUEUE_SIZE;
+	
+	while(1)
+	{
+		cli();
+		
+		if(nextHead != _writeTail)
+		{
+			break;
+		}
+		
+		// Queue is full, wait for next EE_RDY interrupt.
+		HAL_SLEEP();
+	}
+	
+	_writeQueue[_writeHead].address = address;
+	_writeQueue[_writeHead].data = data;
+	_writeHead = nextHead;
+	
+	// Enable EE_RDY interrupt to start (or continue) the queue processing.
+	HAL_EEPROM_IRQ_ENABLE();
+	sei();
+}
+
+/*************************************************************************
+ Queue block of data to write into the EEPROM in background. Bytes are 
+ written in the same order as in the buffer.
+ 
+ address: Start address of the EEPROM block.
+ 
+ data: Buffer to write.
+ 
+ length: Number of bytes to write.
+ 
+ Return: None
+*************************************************************************/
+VOID writeMemoryBlock(UINT address, PUCHAR data, UCHAR length)
+{
+	while(length--)
+	{
+		writeMemoryByte(address++, *data++);
+	}
+}
+
+/*************************************************************************
+ Check status of the background EEPROM writer.
+ 
+ Return: TRUE if EEPROM write(s) are pending, otherwise FALSE.
+*************************************************************************/
+UCHAR isMemoryBusy(VOID)
+{
+	// EE_RDY interrupt stays enabled until the last queued byte is written.
+	return HAL_EEPROM_IRQ_ACTIVE() ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Wait until all the queued EEPROM writes are completed. MCU stays in Idle 
+ sleep mode during the wait.
  
  Return: None
 *************************************************************************/
-VOID saveTimeToMemory(PTIME timeInfo, UCHAR offset)
+VOID waitForMemory(VOID)
 {
-	eeprom_write_byte((UCHAR*)(offset + 0), timeInfo->seconds);
-	eeprom_write_byte((UCHAR*)(offset + 1), timeInfo->minutes);
-	eeprom_write_byte((UCHAR*)(offset + 2), timeInfo->hours);
+	while(1)
+	{
+		cli();
+		
+		if(isMemoryBusy() == FALSE)
+		{
+			sei();
+			return;
+		}
+		
+		HAL_SLEEP();
+	}
 }
 
 /*************************************************************************
@@ -41,7 +128,326 @@ VOID saveTimeToMemory(PTIME timeInfo, UCHAR offset)
 *************************************************************************/
 VOID readTimeFromMemory(PTIME timeInfo, UCHAR offset)
 {
-	timeInfo->seconds = eeprom_read_byte((UCHAR*)(offset + 0));
-	timeInfo->minutes = eeprom_read_byte((UCHAR*)(offset + 1));
-	timeInfo->hours = eeprom_read_byte((UCHAR*)(offset + 2));
+	timeInfo->seconds = HAL_EEPROM_READ_BYTE(offset + 0);
+	timeInfo->minutes = HAL_EEPROM_READ_BYTE(offset + 1);
+	timeInfo->hours = HAL_EEPROM_READ_BYTE(offset + 2);
+}
+
+/*************************************************************************
+ Get EEPROM address of the specified journal record.
+ 
+ recordIndex: Journal record index.
+ 
+ Return: EEPROM address of the record.
+*************************************************************************/
+CONFIG_RECORD* getRecordAddress(UCHAR recordIndex)
+{
+	return (CONFIG_RECORD*)(MEM_JOURNAL_START + (recordIndex * sizeof(CONFIG_RECORD)));
+}
+
+/*************************************************************************
+ Calculate CRC of the specified journal record.
+ 
+ record: Instance of the journal record.
+ 
+ Return: CRC-CCITT of all the fields except the CRC field.
+*************************************************************************/
+UINT getRecordCRC(PCONFIG_RECORD record)
+{
+	UINT crc = 0xFFFF;
+	PUCHAR data = (PUCHAR)record;
+	UCHAR pos;
+	
+	for(pos = 0; pos < (sizeof(CONFIG_RECORD) - sizeof(UINT)); pos++)
+	{
+		crc = _crc_ccitt_update(crc, data[pos]);
+	}
+	
+	return crc;
+}
+
+/*************************************************************************
+ Load newest valid configuration record from the EEPROM journal. Only the
+ sequence numbers are scanned, and then the records are read newest first
+ until one with a valid CRC is found. Records with invalid CRC (partially 
+ written) are ignored.
+ 
+ onTimes: Light on times of all the schedule slots.
+ 
+ offTimes: Light off times of all the schedule slots.
+ 
+ Return: TRUE if valid record is found, otherwise FALSE.
+*************************************************************************/
+UCHAR loadConfiguration(PTIME onTimes, PTIME offTimes)
+{
+	CONFIG_RECORD record;
+	UINT sequences[MEM_JOURNAL_SIZE];
+	UCHAR recordIndex;
+	UCHAR newestIndex;
+	
+	for(recordIndex = 0; recordIndex < MEM_JOURNAL_SIZE; recordIndex++)
+	{
+		HAL_EEPROM_READ_BLOCK(&sequences[recordIndex], &getRecordAddress(recordIndex)->sequence, sizeof(UINT));
+	}
+	
+	while(1)
+	{
+		// Newest record has the highest sequence number (with wrap around).
+		newestIndex = MEM_JOURNAL_SIZE;
+		for(recordIndex = 0; recordIndex < MEM_JOURNAL_SIZE; recordIndex++)
+		{
+			if((sequences[recordIndex] != NO_SEQUENCE) && ((newestIndex == MEM_JOURNAL_SIZE) ||
+				((INT)(sequences[recordIndex] - sequences[newestIndex]) > 0)))
+			{
+				newestIndex = recordIndex;
+			}
+		}
+		
+		if(newestIndex == MEM_JOURNAL_SIZE)
+		{
+			return FALSE;
+		}
+		
+		HAL_EEPROM_READ_BLOCK(&record, getRecordAddress(newestIndex), sizeof(CONFIG_RECORD));
+		
+		if((record.sequence == sequences[newestIndex]) && (record.crc == getRecordCRC(&record)))
+		{
+			break;
+		}
+		
+		// Skip the broken record and try the next newest one.
+		sequences[newestIndex] = NO_SEQUENCE;
+	}
+	
+	_journalIndex = newestIndex;
+	_journalSequence = record.sequence;
+	memcpy(onTimes, record.onTime, sizeof(record.onTime));
+	memcpy(offTimes, record.offTime, sizeof(record.offTime));
+	
+	return TRUE;
+}
+
+/*************************************************************************
+ Append configuration record to the EEPROM journal. Records are written 
+ round-robin to spread the EEPROM wear, and the CRC is written last so a 
+ partially written record never replaces the previous one. Nothing is 
+ written if the configuration is not changed. Record is written by the 
+ background writer, so this function returns without waiting for the 
+ EEPROM (see isMemoryBusy).
+ 
+ onTimes: Light on times of all the schedule slots.
+ 
+ offTimes: Light off times of all the schedule slots.
+ 
+ Return: None
+*************************************************************************/
+VOID saveConfiguration(PTIME onTimes, PTIME offTimes)
+{
+	CONFIG_RECORD record;
+	CONFIG_RECORD* address;
+	
+	if(_journalSequence != NO_SEQUENCE)
+	{
+		// EEPROM can not be read while the background writer is active.
+		waitForMemory();
+		
+		// Skip the write if newest record already holds the same configuration.
+		HAL_EEPROM_READ_BLOCK(&record, getRecordAddress(_journalIndex), sizeof(CONFIG_RECORD));
+		if((memcmp(record.onTime, onTimes, sizeof(record.onTime)) == 0) && (memcmp(record.offTime, offTimes, sizeof(record.offTime)) == 0))
+		{
+			return;
+		}
+		
+		_journalIndex = (_journalIndex + 1) % MEM_JOURNAL_SIZE;
+	}
+	
+	// Sequence number of the erased EEPROM is never used.
+	_journalSequence = ((_journalSequence + 1) == NO_SEQUENCE) ? 0 : (_journalSequence + 1);
+	
+	record.sequence = _journalSequence;
+	memcpy(record.onTime, onTimes, sizeof(record.onTime));
+	memcpy(record.offTime, offTimes, sizeof(record.offTime));
+	record.crc = getRecordCRC(&record);
+	
+	// Queue the record for background write. CRC is written after the 
+	// record content.
+	address = getRecordAddress(_journalIndex);
+	writeMemoryBlock((UINT)address, (PUCHAR)&record, sizeof(CONFIG_RECORD) - sizeof(UINT));
+	writeMemoryBlock((UINT)&address->crc, (PUCHAR)&record.crc, sizeof(UINT));
+}
+
+/*************************************************************************
+ Get EEPROM address of the specified fault log record.
+ 
+ recordIndex: Fault log record index.
+ 
+ Return: EEPROM address of the record.
+*************************************************************************/
+FAULT_RECORD* getFaultRecordAddress(UCHAR recordIndex)
+{
+	return (FAULT_RECORD*)(MEM_FAULT_LOG_START + (recordIndex * sizeof(FAULT_RECORD)));
+}
+
+/*************************************************************************
+ Find newest record of the fault log. Background writer must be idle to 
+ call this function.
+ 
+ sequence: Variable to receive sequence number of the newest record.
+ 
+ Return: Index of the newest record or MEM_FAULT_LOG_SIZE if the fault 
+		 log is empty.
+*************************************************************************/
+UCHAR getFaultLogHead(PUCHAR sequence)
+{
+	UCHAR recordIndex;
+	UCHAR recordSequence;
+	UCHAR headIndex = MEM_FAULT_LOG_SIZE;
+	
+	*sequence = NO_FAULT_SEQUENCE;
+	
+	for(recordIndex = 0; recordIndex < MEM_FAULT_LOG_SIZE; recordIndex++)
+	{
+		recordSequence = HAL_EEPROM_READ_BYTE(&getFaultRecordAddress(recordIndex)->sequence);
+		
+		if(recordSequence == NO_FAULT_SEQUENCE)
+		{
+			continue;
+		}
+		
+		// Newest record has the highest sequence number (with wrap around).
+		if((headIndex == MEM_FAULT_LOG_SIZE) || ((CHAR)(recordSequence - *sequence) > 0))
+		{
+			headIndex = recordIndex;
+			*sequence = recordSequence;
+		}
+	}
+	
+	return headIndex;
+}
+
+/*************************************************************************
+ Append record to the fault log ring buffer. Oldest record is replaced 
+ when the log is full. Sequence number of the replaced record is erased 
+ first and written last, so a partially written record is never shown. 
+ Record is written by the background writer.
+ 
+ record: Fault record to save. Sequence number is assigned by this 
+		 function.
+ 
+ Return: None
+*************************************************************************/
+VOID saveFaultRecord(PFAULT_RECORD record)
+{
+	FAULT_RECORD* address;
+	UCHAR recordIndex;
+	UCHAR sequence;
+	
+	waitForMemory();
+	
+	recordIndex = getFaultLogHead(&sequence);
+	recordIndex = (recordIndex < (MEM_FAULT_LOG_SIZE - 1)) ? (recordIndex + 1) : 0;
+	
+	// Sequence number of the erased EEPROM is never used.
+	record->sequence = ((UCHAR)(sequence + 1) == NO_FAULT_SEQUENCE) ? 0 : (sequence + 1);
+	
+	address = getFaultRecordAddress(recordIndex);
+	writeMemoryByte((UINT)&address->sequence, NO_FAULT_SEQUENCE);
+	writeMemoryBlock((UINT)address, (PUCHAR)record, sizeof(FAULT_RECORD) - sizeof(UCHAR));
+	writeMemoryByte((UINT)&address->sequence, record->sequence);
+}
+
+/*************************************************************************
+ Read record from the fault log.
+ 
+ recordId: Record number starting from 0 (newest record).
+ 
+ record: Buffer to fill with the record content.
+ 
+ Return: TRUE if record is available, otherwise FALSE.
+*************************************************************************/
+UCHAR readFaultRecord(UCHAR recordId, PFAULT_RECORD record)
+{
+	UCHAR headIndex;
+	UCHAR sequence;
+	
+	// EEPROM can not be read while the background writer is active.
+	waitForMemory();
+	
+	headIndex = getFaultLogHead(&sequence);
+	if((headIndex == MEM_FAULT_LOG_SIZE) || (recordId >= MEM_FAULT_LOG_SIZE))
+	{
+		return FALSE;
+	}
+	
+	headIndex = (headIndex + MEM_FAULT_LOG_SIZE - recordId) % MEM_FAULT_LOG_SIZE;
+	HAL_EEPROM_READ_BLOCK(record, getFaultRecordAddress(headIndex), sizeof(FAULT_RECORD));
+	
+	return (record->sequence != NO_FAULT_SEQUENCE) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ EEPROM ready interrupt. Write next queued byte which differs from the 
+ current EEPROM content. Interrupt is disabled once the queue is empty.
+*************************************************************************/
+ISR(EE_RDY_vect)
+{
+	PMEM_WRITE request;
+	PROFILE_ISR_BEGIN(PROFILE_NO_LATENCY);
+	
+	while(_writeTail != _writeHead)
+	{
+		request = &_writeQueue[_writeTail];
+		_writeTail = (_writeTail + 1) % MEM_QUEUE_SIZE;
+		
+		// Read current content to skip unchanged bytes.
+		if(HAL_EEPROM_GET(request->address) != request->data)
+		{
+			HAL_EEPROM_PUT(request->data);
+			PROFILE_ISR_END(PROFILE_EEPROM);
+			return;
+		}
+	}
+	
+	HAL_EEPROM_IRQ_DISABLE();
+	PROFILE_ISR_END(PROFILE_EEPROM);
+}
+
+/*************************************************************************
+ Load last state of the master light from the EEPROM. This function 
+ should be called during the startup before any EEPROM write is queued.
+ 
+ isActive: Variable to receive the light state.
+ 
+ Return: TRUE if the light state is stored, otherwise FALSE.
+*************************************************************************/
+UCHAR loadLightState(PUCHAR isActive)
+{
+	_savedLightState = HAL_EEPROM_READ_BYTE(MEM_LIGHT_STATE);
+	
+	if((_savedLightState != MEM_LIGHT_OFF) && (_savedLightState != MEM_LIGHT_ON))
+	{
+		return FALSE;
+	}
+	
+	*isActive = (_savedLightState == MEM_LIGHT_ON) ? TRUE : FALSE;
+	return TRUE;
+}
+
+/*************************************************************************
+ Store state of the master light in the EEPROM. Byte is written by the 
+ background writer, and only if the state is changed.
+ 
+ isActive: Current state of the master light.
+ 
+ Return: None
+*************************************************************************/
+VOID saveLightState(UCHAR isActive)
+{
+	UCHAR state = (isActive == TRUE) ? MEM_LIGHT_ON : MEM_LIGHT_OFF;
+	
+	if(state != _savedLightState)
+	{
+		_savedLightState = state;
+		writeMemoryByte(MEM_LIGHT_STATE, state);
+	}
 }
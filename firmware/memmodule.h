@@ -12,7 +12,88 @@
 #ifndef MEMORY_MODULE_HEADER
 #define MEMORY_MODULE_HEADER
 
-VOID saveTimeToMemory(PTIME timeInfo, UCHAR offset);
+// EEPROM offsets of the schedule slots. Each slot holds the on time 
+// followed by the off time.
+#define MEM_SLOT_SIZE		8
+#define MEM_ON_TIME(s)		((s) * MEM_SLOT_SIZE)
+#define MEM_OFF_TIME(s)		(((s) * MEM_SLOT_SIZE) + 4)
+
+// Size of the background EEPROM write queue. Queue can hold one complete 
+// configuration record.
+#define MEM_QUEUE_SIZE		32
+
+// Background EEPROM write request.
+struct memWriteStruct
+{
+	UINT address;
+	UCHAR data;
+};
+
+#define MEM_WRITE	struct memWriteStruct
+#define PMEM_WRITE	MEM_WRITE*
+
+// Number of records in the fault log ring buffer.
+#define MEM_FAULT_LOG_SIZE	4
+
+// Fault log occupies the end of the EEPROM.
+#define MEM_FAULT_LOG_START	(HAL_EEPROM_SIZE - (MEM_FAULT_LOG_SIZE * sizeof(FAULT_RECORD)))
+
+// Last state of the master light is stored in the byte below the fault 
+// log. Erased EEPROM holds neither of the state values.
+#define MEM_LIGHT_STATE		(MEM_FAULT_LOG_START - 1)
+#define MEM_LIGHT_OFF		0x00
+#define MEM_LIGHT_ON		0x01
+
+// Configuration journal occupies the EEPROM between the legacy schedule 
+// area and the light state.
+#define MEM_JOURNAL_START	(SCHEDULE_SLOTS * MEM_SLOT_SIZE)
+#define MEM_JOURNAL_END		MEM_LIGHT_STATE
+#define MEM_JOURNAL_SIZE	((MEM_JOURNAL_END - MEM_JOURNAL_START) / sizeof(CONFIG_RECORD))
+
+// Sequence number of the erased EEPROM.
+#define NO_SEQUENCE			0xFFFF
+
+// Configuration journal record. CRC covers all the other fields.
+struct configRecordStruct
+{
+	UINT sequence;
+	TIME onTime[SCHEDULE_SLOTS];
+	TIME offTime[SCHEDULE_SLOTS];
+	UINT crc;
+};
+
+#define CONFIG_RECORD	struct configRecordStruct
+#define PCONFIG_RECORD	CONFIG_RECORD*
+
+// Sequence number of the erased fault log record.
+#define NO_FAULT_SEQUENCE	0xFF
+
+// Fault log record. Sequence number is written last.
+struct faultRecordStruct
+{
+	UCHAR resetCause;
+	UCHAR taskId;
+	UINT32 uptime;
+	UCHAR sequence;
+};
+
+#define FAULT_RECORD	struct faultRecordStruct
+#define PFAULT_RECORD	FAULT_RECORD*
+
 VOID readTimeFromMemory(PTIME timeInfo, UCHAR offset);
 
+VOID writeMemoryByte(UINT address, UCHAR data);
+VOID writeMemoryBlock(UINT address, PUCHAR data, UCHAR length);
+UCHAR isMemoryBusy(VOID);
+VOID waitForMemory(VOID);
+
+UCHAR loadConfiguration(PTIME onTimes, PTIME offTimes);
+VOID saveConfiguration(PTIME onTimes, PTIME offTimes);
+
+VOID saveFaultRecord(PFAULT_RECORD record);
+UCHAR readFaultRecord(UCHAR recordId, PFAULT_RECORD record);
+
+UCHAR loadLightState(PUCHAR isActive);
+VOID saveLightState(UCHAR isActive);
+
 #endif
@@ -0,0 +1,244 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     nvrammodule.c
+* Info:		Settings cache in battery backed RAM of the DS1307 RTC.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "nvrammodule.h"
+#include "rtcmodule.h"
+#include "halmodule.h"
+
+#include <string.h>
+
+// Settings must fit into the battery backed RAM of the DS1307.
+_Static_assert(sizeof(NVRAM_DATA) <= DS1307_RAM_SIZE, "NVRAM_DATA does not fit into the DS1307 RAM.");
+
+// RAM copy of the RTC RAM content.
+NVRAM_DATA _nvramData;
+
+// Set if the RTC RAM could not be read. RAM copy is not written into the 
+// RTC until the content is loaded, to keep the stored counters.
+UCHAR _nvramReadFailed = FALSE;
+UCHAR _nvramRetryDelay = 0;
+
+// Set if RAM copy is modified and not yet written into the RTC.
+UCHAR _nvramDirty = FALSE;
+
+// Seconds counter of the active light state.
+UCHAR _nvramSeconds = 0;
+
+/*************************************************************************
+ Calculate checksum of the settings.
+ 
+ data: Instance of the settings data structure.
+ 
+ Return: Dallas / Maxim CRC-8 of all the fields except the checksum.
+*************************************************************************/
+UCHAR getNVRAMChecksum(PNVRAM_DATA data)
+{
+	UCHAR crc = 0;
+	PUCHAR buffer = (PUCHAR)data;
+	UCHAR pos;
+	
+	for(pos = 0; pos < (sizeof(NVRAM_DATA) - 1); pos++)
+	{
+		crc = _crc_ibutton_update(crc, buffer[pos]);
+	}
+	
+	return crc;
+}
+
+/*************************************************************************
+ Write modified settings into the RTC RAM. If the previous RTC RAM write 
+ is still in progress, write is retried on the next call. Nothing is 
+ written until the settings are loaded by loadNVRAM.
+ 
+ Return: None
+*************************************************************************/
+VOID flushNVRAM()
+{
+	if((_nvramDirty == TRUE) && (_nvramData.signature == NVRAM_SIGNATURE))
+	{
+		_nvramData.checksum = getNVRAMChecksum(&_nvramData);
+		if(writeRTCMemory(0, (PUCHAR)&_nvramData, sizeof(NVRAM_DATA)) == TRUE)
+		{
+			_nvramDirty = FALSE;
+		}
+	}
+}
+
+/*************************************************************************
+ Check signature and checksum of the settings read from the RTC RAM.
+ 
+ data: Instance of the settings data structure.
+ 
+ Return: TRUE if settings are valid, otherwise FALSE.
+*************************************************************************/
+UCHAR isValidNVRAM(PNVRAM_DATA data)
+{
+	return ((data->signature == NVRAM_SIGNATURE) && (data->checksum == getNVRAMChecksum(data))) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Load settings from the RTC RAM. Schedule is copied only if the RTC RAM 
+ holds valid settings. Runtime state and counters are reset only if the 
+ RTC RAM content is invalid. If the RTC does not respond, nothing is 
+ written into the RTC RAM until updateNVRAMState loads it.
+ 
+ onTimes: Light on times of all the schedule slots.
+ 
+ offTimes: Light off times of all the schedule slots.
+ 
+ Return: TRUE if valid settings are found, otherwise FALSE.
+*************************************************************************/
+UCHAR loadNVRAM(PTIME onTimes, PTIME offTimes)
+{
+	UCHAR isRead = readRTCMemory(0, (PUCHAR)&_nvramData, sizeof(NVRAM_DATA));
+	
+	if((isRead == TRUE) && (isValidNVRAM(&_nvramData) == TRUE))
+	{
+		memcpy(onTimes, _nvramData.onTime, sizeof(_nvramData.onTime));
+		memcpy(offTimes, _nvramData.offTime, sizeof(_nvramData.offTime));
+		return TRUE;
+	}
+	
+	memset(&_nvramData, 0, sizeof(NVRAM_DATA));
+	_nvramData.lightState = FALSE;
+	
+	if(isRead == TRUE)
+	{
+		_nvramData.signature = NVRAM_SIGNATURE;
+	}
+	else
+	{
+		_nvramReadFailed = TRUE;
+		_nvramRetryDelay = NVRAM_RETRY_PERIOD;
+	}
+	
+	return FALSE;
+}
+
+/*************************************************************************
+ Retry the RTC RAM read which failed in loadNVRAM. Stored counters are 
+ merged into the RAM copy, and the schedule and light state of the RAM 
+ copy are kept as they are already set by the main module.
+ 
+ Return: None
+*************************************************************************/
+VOID retryNVRAMLoad()
+{
+	NVRAM_DATA runtimeData = _nvramData;
+	UCHAR isRead = readRTCMemory(0, (PUCHAR)&_nvramData, sizeof(NVRAM_DATA));
+	
+	if((isRead == TRUE) && (isValidNVRAM(&_nvramData) == TRUE))
+	{
+		runtimeData.lightOnCount += _nvramData.lightOnCount;
+		runtimeData.lightOnMinutes += _nvramData.lightOnMinutes;
+	}
+	
+	_nvramData = runtimeData;
+	
+	if(isRead == FALSE)
+	{
+		_nvramRetryDelay = NVRAM_RETRY_PERIOD;
+		return;
+	}
+	
+	_nvramReadFailed = FALSE;
+	_nvramData.signature = NVRAM_SIGNATURE;
+	_nvramDirty = TRUE;
+}
+
+/*************************************************************************
+ Mirror schedule into the RTC RAM. This function returns without waiting 
+ for the I2C transfer.
+ 
+ onTimes: Light on times of all the schedule slots.
+ 
+ offTimes: Light off times of all the schedule slots.
+ 
+ Return: None
+*************************************************************************/
+VOID saveScheduleToNVRAM(PTIME onTimes, PTIME offTimes)
+{
+	// RAM copy is also updated by the WORK_NVRAM deferred work. Both run in 
+	// the main loop context, so the RAM copy is not shared with any ISR.
+	memcpy(_nvramData.onTime, onTimes, sizeof(_nvramData.onTime));
+	memcpy(_nvramData.offTime, offTimes, sizeof(_nvramData.offTime));
+	_nvramDirty = TRUE;
+	flushNVRAM();
+}
+
+/*************************************************************************
+ Update light state and usage counters in the RTC RAM. This function 
+ should be called once per second in the main loop context, as a failed
+ load of the RTC RAM is retried with a blocking read.
+ 
+ isLightActive: Current state of the master light.
+ 
+ Return: None
+*************************************************************************/
+VOID updateNVRAMState(UCHAR isLightActive)
+{
+	if((_nvramReadFailed == TRUE) && ((--_nvramRetryDelay) == 0))
+	{
+		retryNVRAMLoad();
+	}
+	
+	if(isLightActive != _nvramData.lightState)
+	{
+		if(isLightActive == TRUE)
+		{
+			_nvramData.lightOnCount++;
+		}
+		
+		_nvramData.lightState = isLightActive;
+		_nvramDirty = TRUE;
+	}
+	
+	// Count active minutes of the master light.
+	if((isLightActive == TRUE) && (++_nvramSeconds >= 60))
+	{
+		_nvramSeconds = 0;
+		_nvramData.lightOnMinutes++;
+		_nvramDirty = TRUE;
+	}
+	
+	flushNVRAM();
+}
+
+/*************************************************************************
+ Get last known state of the master light.
+ 
+ Return: TRUE if master light was active, otherwise FALSE.
+*************************************************************************/
+UCHAR getLastLightState()
+{
+	return _nvramData.lightState;
+}
+
+/*************************************************************************
+ Get number of master light activations stored in the RTC RAM.
+ 
+ Return: Number of light on transitions.
+*************************************************************************/
+UINT getLightOnCount()
+{
+	return _nvramData.lightOnCount;
+}
+
+/*************************************************************************
+ Get total active time of the master light stored in the RTC RAM.
+ 
+ Return: Active time in minutes.
+*************************************************************************/
+UINT32 getLightOnMinutes()
+{
+	return _nvramData.lightOnMinutes;
+}
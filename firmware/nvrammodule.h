@@ -0,0 +1,45 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     nvrammodule.h
+* Info:		Settings cache in battery backed RAM of the DS1307 RTC.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef NVRAM_MODULE_HEADER
+#define NVRAM_MODULE_HEADER
+
+// Signature to identify initialized RTC RAM.
+#define NVRAM_SIGNATURE		0xA5
+
+// Interval between attempts to load the RTC RAM after a failed read, in 
+// calls of updateNVRAMState (seconds).
+#define NVRAM_RETRY_PERIOD	30
+
+// Settings mirrored into the RTC RAM. Structure must fit into the 56 bytes 
+// of the DS1307 RAM, and the checksum must be the last field.
+struct nvramStruct
+{
+	UCHAR signature;
+	TIME onTime[SCHEDULE_SLOTS];
+	TIME offTime[SCHEDULE_SLOTS];
+	UCHAR lightState;
+	UINT lightOnCount;
+	UINT32 lightOnMinutes;
+	UCHAR checksum;
+};
+
+#define NVRAM_DATA	struct nvramStruct
+#define PNVRAM_DATA	NVRAM_DATA*
+
+UCHAR loadNVRAM(PTIME onTimes, PTIME offTimes);
+VOID saveScheduleToNVRAM(PTIME onTimes, PTIME offTimes);
+VOID updateNVRAMState(UCHAR isLightActive);
+UCHAR getLastLightState();
+UINT getLightOnCount();
+UINT32 getLightOnMinutes();
+
+#endif
@@ -0,0 +1,175 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     profilemodule.c
+* Info:		ISR and main loop execution time profiler.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "profilemodule.h"
+#include "displaymodule.h"
+
+#if PROFILE_ENABLE
+
+#include "halmodule.h"
+
+PROFILE_DATA _profileData[PROFILE_COUNT];
+
+// Display labels of the profiled sections: systick, i2C, Eeprom and 
+// main Program loop.
+const UCHAR _profileLabels[PROFILE_COUNT] PROGMEM = {'T', 'C', 'E', 'P'};
+
+// Display labels of the minimum, average and maximum values.
+const UCHAR _statLabels[3] PROGMEM = {'_', '-', '^'};
+
+/*************************************************************************
+ Reset profiler statistics and start free running timer0 which is used 
+ as the time reference.
+
+ Return: None
+*************************************************************************/
+VOID initProfileModule()
+{
+	UCHAR sectionId;
+	
+	for(sectionId = 0; sectionId < PROFILE_COUNT; sectionId++)
+	{
+		_profileData[sectionId].minTime = 0xFFFF;
+		_profileData[sectionId].maxTime = 0;
+		_profileData[sectionId].totalTime = 0;
+		_profileData[sectionId].minLatency = 0xFFFF;
+		_profileData[sectionId].maxLatency = 0;
+		_profileData[sectionId].totalLatency = 0;
+		_profileData[sectionId].count = 0;
+	}
+	
+	// Timer0 with prescaler 8.
+	HAL_PROFILE_TIMER_INIT();
+}
+
+/*************************************************************************
+ Record one execution of the profiled code section.
+
+ sectionId: Profiled section (PROFILE_xxx).
+ 
+ execTime: Execution time in microseconds.
+ 
+ latency: Entry latency in microseconds or PROFILE_NO_LATENCY.
+
+ Return: None
+*************************************************************************/
+VOID recordProfile(UCHAR sectionId, UINT execTime, UINT latency)
+{
+	PPROFILE_DATA data = &_profileData[sectionId];
+	UCHAR sreg = SREG;
+	
+	cli();
+	
+	// Keep running average by halving the totals before the counter overflows.
+	if(data->count == 0xFFFF)
+	{
+		data->count >>= 1;
+		data->totalTime >>= 1;
+		data->totalLatency >>= 1;
+	}
+	
+	data->count++;
+	data->totalTime += execTime;
+	
+	if(execTime < data->minTime)
+	{
+		data->minTime = execTime;
+	}
+	
+	if(execTime > data->maxTime)
+	{
+		data->maxTime = execTime;
+	}
+	
+	if(latency != PROFILE_NO_LATENCY)
+	{
+		data->totalLatency += latency;
+		
+		if(latency < data->minLatency)
+		{
+			data->minLatency = latency;
+		}
+		
+		if(latency > data->maxLatency)
+		{
+			data->maxLatency = latency;
+		}
+	}
+	
+	SREG = sreg;
+}
+
+/*************************************************************************
+ Fill display buffer with label or value of the profiler item. Each 
+ profiled section has six items: minimum, average and maximum execution 
+ time (label "Sr _", "Sr -", "Sr ^") followed by the same values of the 
+ entry latency (label "SL _", "SL -", "SL ^").
+
+ itemId: Profiler item from 0 to PROFILE_ITEM_COUNT - 1.
+ 
+ isValue: TRUE to show the value in microseconds, FALSE to show the label.
+ 
+ displayData: Display buffer to fill.
+
+ Return: None
+*************************************************************************/
+VOID profileItemToDisplay(UCHAR itemId, UCHAR isValue, PDISPLAY displayData)
+{
+	PROFILE_DATA data;
+	UCHAR sectionId = itemId / PROFILE_STAT_COUNT;
+	UCHAR statId = itemId % PROFILE_STAT_COUNT;
+	UINT value;
+	UCHAR sreg = SREG;
+	
+	if(isValue == FALSE)
+	{
+		textToDisplay(pgm_read_byte(&_profileLabels[sectionId]), (statId < 3) ? 'r' : 'L', ' ', pgm_read_byte(&_statLabels[statId % 3]), displayData);
+		return;
+	}
+	
+	cli();
+	data = _profileData[sectionId];
+	SREG = sreg;
+	
+	if((data.count == 0) || ((statId >= 3) && (data.maxLatency == 0) && (data.minLatency == 0xFFFF)))
+	{
+		// Not measured.
+		textToDisplay('-', '-', '-', '-', displayData);
+		return;
+	}
+	
+	switch(statId)
+	{
+		case 0:
+			value = data.minTime;
+			break;
+		case 1:
+			value = (UINT)(data.totalTime / data.count);
+			break;
+		case 2:
+			value = data.maxTime;
+			break;
+		case 3:
+			value = data.minLatency;
+			break;
+		case 4:
+			value = (UINT)(data.totalLatency / data.count);
+			break;
+		default:
+			value = data.maxLatency;
+			break;
+	}
+	
+	numberToDisplay(value, 0xFF, displayData);
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     profilemodule.h
+* Info:		ISR and main loop execution time profiler.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef PROFILE_MODULE_HEADER
+#define PROFILE_MODULE_HEADER
+
+// Set to 1 to enable the profiler. If the profiler is disabled all the 
+// profiler macros expand to nothing.
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE	0
+#endif
+
+// Profiled code sections.
+#define PROFILE_TICK		0
+#define PROFILE_TWI			1
+#define PROFILE_EEPROM		2
+#define PROFILE_MAIN_LOOP	3
+
+#define PROFILE_COUNT		4
+
+// Latency value for the sections without a hardware time reference.
+#define PROFILE_NO_LATENCY	0xFFFF
+
+// Statistics of each profiled section: execution time and entry latency 
+// as minimum, average and maximum values.
+#define PROFILE_STAT_COUNT	6
+#define PROFILE_ITEM_COUNT	(PROFILE_COUNT * PROFILE_STAT_COUNT)
+
+#if PROFILE_ENABLE
+
+#include "halmodule.h"
+
+// ISR execution time is measured with free running timer0 (prescaler 8), 
+// which gives 2us resolution and up to 510us range.
+#define PROFILE_TIMER_US	(8 / (F_CPU / 1000000UL))
+
+// Statistics of the profiled code section. All the values are in 
+// microseconds.
+struct profileStruct
+{
+	UINT minTime;
+	UINT maxTime;
+	UINT32 totalTime;
+	UINT minLatency;
+	UINT maxLatency;
+	UINT32 totalLatency;
+	UINT count;
+};
+
+#define PROFILE_DATA	struct profileStruct
+#define PPROFILE_DATA	PROFILE_DATA*
+
+// Place PROFILE_ISR_BEGIN at the start of the ISR and PROFILE_ISR_END 
+// before every exit point of the ISR.
+#define PROFILE_ISR_BEGIN(latency)	UCHAR profileStart = HAL_PROFILE_TIMER_COUNT(); UINT profileLatency = (latency)
+#define PROFILE_ISR_END(id)			recordProfile((id), (UCHAR)(HAL_PROFILE_TIMER_COUNT() - profileStart) * PROFILE_TIMER_US, profileLatency)
+
+VOID initProfileModule();
+VOID recordProfile(UCHAR sectionId, UINT execTime, UINT latency);
+VOID profileItemToDisplay(UCHAR itemId, UCHAR isValue, PDISPLAY displayData);
+
+#else
+
+#define PROFILE_ISR_BEGIN(latency)
+#define PROFILE_ISR_END(id)
+
+#endif
+
+#endif
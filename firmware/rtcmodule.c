@@ -11,10 +11,9 @@
 
 #include "sysbasedef.h"
 #include "rtcmodule.h"
-#include "i2cmaster.h"
-
-#include <avr/io.h>
-#include <util/delay.h>	
+#include "twimodule.h"
+#include "timermodule.h"
+#include "halmodule.h"
 
 #define DS1307_ADDRESS	0xD0
 
@@ -22,27 +21,294 @@
 #define DS1307_MINUTES	0x01
 #define DS1307_HOURS	0x02
 #define DS1307_CONTROL	0x07
+#define DS1307_RAM		0x08
+
+// Mode bits of the hours register.
+#define DS1307_12_HOUR	0x40
+#define DS1307_PM		0x20
+
+// Number of time registers used by the system (seconds, minutes and hours).
+#define DS1307_TIME_SIZE	3
+
+// Register address used to read time registers.
+UCHAR _rtcTimeRegister = DS1307_SECONDS;
+
+// Background time read transaction and its receive buffer.
+UCHAR _rtcTimeBuffer[DS1307_TIME_SIZE];
+TWI_TRANSACTION _rtcReadTransaction;
+
+// Clock halt (CH) bit of the last background time read.
+UCHAR _rtcHalted = FALSE;
+
+// Number of readSystemTime calls since the background time read is 
+// submitted.
+UCHAR _rtcReadAge = 0;
+
+// Back off state of the failed background time reads.
+UCHAR _rtcBackoff = 0;
+UCHAR _rtcRetryDelay = 0;
+
+// Background oscillator restart transaction.
+UCHAR _rtcStartBuffer[2];
+TWI_TRANSACTION _rtcStartTransaction;
+
+// Battery backed RAM write transaction. First byte of the buffer is the 
+// register address.
+UCHAR _rtcMemoryBuffer[DS1307_RAM_SIZE + 1];
+TWI_TRANSACTION _rtcMemoryTransaction;
 
 /*************************************************************************
- Initialize DS1307 RTC module and start timer.
+ Fill write transaction to the DS1307 RTC.
+
+ transaction: Instance of the transaction to fill.
+ 
+ writeBuffer: Register address followed by the register values.
+ 
+ writeLength: Number of bytes in the write buffer.
+
+ Return: None
+*************************************************************************/
+VOID setupRTCWrite(PTWI_TRANSACTION transaction, PUCHAR writeBuffer, UCHAR writeLength)
+{
+	transaction->address = DS1307_ADDRESS;
+	transaction->writeBuffer = writeBuffer;
+	transaction->writeLength = writeLength;
+	transaction->readBuffer = 0;
+	transaction->readLength = 0;
+	transaction->onComplete = 0;
+}
+
+/*************************************************************************
+ Submit blocking transaction to the DS1307 RTC and wait for the result. 
+ Submission waits until the TWI queue has a free slot. Failed transfers 
+ are retried with increasing delay between the attempts.
+
+ transaction: Instance of the read or write transaction.
+
+ Return: TRUE if transfer is successful, otherwise FALSE.
+*************************************************************************/
+UCHAR transferRTC(PTWI_TRANSACTION transaction)
+{
+	UCHAR attempt;
+	UINT startTick;
+	
+	for(attempt = 0; attempt < RTC_RETRY_LIMIT; attempt++)
+	{
+		if(attempt > 0)
+		{
+			startTick = getSystemTicks();
+			while((UINT)(getSystemTicks() - startTick) < (TIMER_MS_TO_TICKS(RTC_RETRY_DELAY) << (attempt - 1)))
+			{
+				HAL_WAIT();
+			}
+		}
+		
+		while(twiSubmit(transaction) == FALSE)
+		{
+			HAL_WAIT();
+		}
+		
+		if(twiWait(transaction) == TWI_DONE)
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+/*************************************************************************
+ Decode time registers received from RTC. Hours register is decoded in 
+ both 12 and 24 hour modes. Out of range 12 hour values are returned as 
+ an invalid hour.
+
+ timeBuffer: Seconds, minutes and hours registers in BCD format.
+ 
+ timeInfo: Data structure to fill current time.
+
+ Return: None
+*************************************************************************/
+VOID decodeRTCTime(PUCHAR timeBuffer, PTIME timeInfo)
+{
+	UCHAR hours;
+	
+	timeInfo->seconds = bcdToDec(timeBuffer[0] & 0x7F);
+	timeInfo->minutes = bcdToDec(timeBuffer[1]);
+	
+	if(timeBuffer[2] & DS1307_12_HOUR)
+	{
+		// Hours 1 to 12 with the PM flag.
+		hours = bcdToDec(timeBuffer[2] & 0x1F);
+		if((hours == 0) || (hours > 12))
+		{
+			timeInfo->hours = 0xFF;
+			return;
+		}
+		
+		timeInfo->hours = (hours % 12) + ((timeBuffer[2] & DS1307_PM) ? 12 : 0);
+	}
+	else
+	{
+		timeInfo->hours = bcdToDec(timeBuffer[2] & 0x3F);
+	}
+}
+
+/*************************************************************************
+ Restart RTC oscillator if the clock halt (CH) bit is set. Oscillator is
+ restarted without changing the seconds value. If the TWI queue is full 
+ the restart is skipped, and it is retried on the next time read as the 
+ CH bit stays set.
+
+ secondsRegister: Value of the seconds register received from RTC.
+
+ Return: None
+*************************************************************************/
+VOID checkRTCOscillator(UCHAR secondsRegister)
+{
+	if((secondsRegister & 0x80) && IS_TWI_COMPLETE(&_rtcStartTransaction))
+	{
+		_rtcStartBuffer[0] = DS1307_SECONDS;
+		_rtcStartBuffer[1] = secondsRegister & 0x7F;
+		setupRTCWrite(&_rtcStartTransaction, _rtcStartBuffer, 2);
+		twiSubmit(&_rtcStartTransaction);
+	}
+}
+
+/*************************************************************************
+ Initialize DS1307 RTC module. This function does not communicate with 
+ the RTC, and the clock halt bit is checked on each time read.
 
  Return: None
 *************************************************************************/
 VOID initRTCModule()
 {
-	// Initialize I2C module and library.
-	i2c_init();
-	_delay_ms(5);
+	// Initialize interrupt driven I2C module.
+	initTWIModule();
 	
-	// Update CH bit of address 0x00.
-	i2c_start_wait(DS1307_ADDRESS + I2C_WRITE);
-	i2c_write(DS1307_SECONDS);
-	i2c_write(0x00);
-	i2c_stop();
+	_rtcReadTransaction.address = DS1307_ADDRESS;
+	_rtcReadTransaction.writeBuffer = &_rtcTimeRegister;
+	_rtcReadTransaction.writeLength = 1;
+	_rtcReadTransaction.readBuffer = _rtcTimeBuffer;
+	_rtcReadTransaction.readLength = DS1307_TIME_SIZE;
+	_rtcReadTransaction.onComplete = 0;
+	_rtcReadTransaction.status = TWI_IDLE;
+}
+
+/*************************************************************************
+ Start background read of the system time from RTC. This function returns
+ immediately and the result is available through readSystemTime. Request
+ is ignored if the previous read is still in progress or a failed read 
+ is waiting for the retry.
+
+ Return: None
+*************************************************************************/
+VOID requestSystemTime()
+{
+	if((_rtcRetryDelay == 0) && IS_TWI_COMPLETE(&_rtcReadTransaction))
+	{
+		twiSubmit(&_rtcReadTransaction);
+		_rtcReadAge = 0;
+	}
 }
 
 /*************************************************************************
- Get system time from RTC.
+ Get result of the last background time read started by 
+ requestSystemTime. Failed reads are retried by this function after the 
+ back off delay, so it should be called on every software clock tick 
+ (once per second). Stopped oscillator is not restarted by this function 
+ (see isRTCHalted).
+
+ timeInfo: Data structure to fill current time.
+
+ Return: TRUE if new time is available, otherwise FALSE.
+*************************************************************************/
+UCHAR readSystemTime(PTIME timeInfo)
+{
+	// Schedule the retry of the failed read. Retry delay is doubled on 
+	// each consecutive failure.
+	if(IS_TWI_FAILED(&_rtcReadTransaction))
+	{
+		_rtcReadTransaction.status = TWI_IDLE;
+		_rtcRetryDelay = 1 << _rtcBackoff;
+		
+		if(_rtcBackoff < RTC_BACKOFF_LIMIT)
+		{
+			_rtcBackoff++;
+		}
+		
+		return FALSE;
+	}
+	
+	if(_rtcRetryDelay > 0)
+	{
+		if((--_rtcRetryDelay) == 0)
+		{
+			twiSubmit(&_rtcReadTransaction);
+			_rtcReadAge = 0;
+		}
+		
+		return FALSE;
+	}
+	
+	if(_rtcReadAge < 0xFF)
+	{
+		_rtcReadAge++;
+	}
+	
+	if(_rtcReadTransaction.status != TWI_DONE)
+	{
+		return FALSE;
+	}
+	
+	_rtcBackoff = 0;
+	decodeRTCTime(_rtcTimeBuffer, timeInfo);
+	_rtcHalted = (_rtcTimeBuffer[0] & 0x80) ? TRUE : FALSE;
+	
+	// Mark the result as consumed.
+	_rtcReadTransaction.status = TWI_IDLE;
+	return TRUE;
+}
+
+/*************************************************************************
+ Check the clock halt (CH) bit received on the last background time read.
+ Time of a halted RTC does not advance.
+
+ Return: TRUE if RTC oscillator is stopped, otherwise FALSE.
+*************************************************************************/
+UCHAR isRTCHalted()
+{
+	return _rtcHalted;
+}
+
+/*************************************************************************
+ Get age of the time received on the last background time read. Time is 
+ read right after the request is submitted, and it is consumed by a 
+ later readSystemTime call.
+
+ Return: Number of readSystemTime calls (software clock ticks) since the 
+		 read is submitted.
+*************************************************************************/
+UCHAR getRTCReadAge()
+{
+	return _rtcReadAge;
+}
+
+/*************************************************************************
+ Restart RTC oscillator stopped on the last background time read without
+ changing the RTC time. This function returns without waiting for the 
+ I2C transfer, and it should be called before the next time read is 
+ requested.
+
+ Return: None
+*************************************************************************/
+VOID restartRTCOscillator()
+{
+	checkRTCOscillator(_rtcTimeBuffer[0]);
+}
+
+/*************************************************************************
+ Get system time from RTC. This function waits until the read operation 
+ is completed. Time is not changed if the RTC does not respond.
 
  timeInfo: Data structure to fill current time.
 
@@ -50,41 +316,133 @@ VOID initRTCModule()
 *************************************************************************/
 VOID getSystemTime(PTIME timeInfo)
 {
+	UCHAR timeBuffer[DS1307_TIME_SIZE];
+	TWI_TRANSACTION transaction;
+	
 	// Request beginning of the time registers of DS1307 RTC.
-	i2c_start_wait(DS1307_ADDRESS + I2C_WRITE);
-	i2c_write(DS1307_SECONDS);
+	transaction.address = DS1307_ADDRESS;
+	transaction.writeBuffer = &_rtcTimeRegister;
+	transaction.writeLength = 1;
+	transaction.readBuffer = timeBuffer;
+	transaction.readLength = DS1307_TIME_SIZE;
+	transaction.onComplete = 0;
 	
 	// Read time values from DS1307 RTC.
-	i2c_start_wait(DS1307_ADDRESS + I2C_READ);
-	timeInfo->seconds = bcdToDec(i2c_readAck() & 0x7F);
-	timeInfo->minutes = bcdToDec(i2c_readAck());
-	timeInfo->hours = bcdToDec(i2c_readNak());
-	i2c_stop();
+	if(transferRTC(&transaction) == TRUE)
+	{
+		decodeRTCTime(timeBuffer, timeInfo);
+		checkRTCOscillator(timeBuffer[0]);
+	}
 }
 
-VOID setSystemTime(PTIME timeInfo)
+/*************************************************************************
+ Set system time of the RTC. This function waits until both the time 
+ setup and the oscillator restart are written into the RTC. If only the 
+ restart fails, the oscillator is restarted by the next time read.
+
+ timeInfo: Time to set in the RTC.
+
+ Return: TRUE if time is written, otherwise FALSE.
+*************************************************************************/
+UCHAR setSystemTime(PTIME timeInfo)
 {
+	UCHAR setupBuffer[8];
+	UCHAR startBuffer[2];
+	TWI_TRANSACTION transaction;
+	
 	// Request beginning of the time registers of DS1307 RTC.
-	i2c_start_wait(DS1307_ADDRESS + I2C_WRITE);
-	i2c_write(DS1307_SECONDS);
+	setupBuffer[0] = DS1307_SECONDS;
 	
-	// Stop RTC oscillator and reset seconds.
-	i2c_write(0x80);
-	i2c_write(decToBcd(timeInfo->minutes));
-	i2c_write(decToBcd(timeInfo->hours));
+	// Stop RTC oscillator while the time registers are written.
+	setupBuffer[1] = 0x80 | decToBcd(timeInfo->seconds);
+	setupBuffer[2] = decToBcd(timeInfo->minutes);
+	setupBuffer[3] = decToBcd(timeInfo->hours);
 	
 	// We don't care about date, month and year. Lets configure some fixed values to those parameters.
-	i2c_write(decToBcd(0x01));
-	i2c_write(decToBcd(0x01));
-	i2c_write(decToBcd(0x01));
-	i2c_write(decToBcd(0x015));
-	i2c_stop();
+	setupBuffer[4] = decToBcd(0x01);
+	setupBuffer[5] = decToBcd(0x01);
+	setupBuffer[6] = decToBcd(0x01);
+	setupBuffer[7] = decToBcd(0x015);
+	setupRTCWrite(&transaction, setupBuffer, 8);
+	
+	if(transferRTC(&transaction) == FALSE)
+	{
+		return FALSE;
+	}
 	
 	// Restart oscillator.
-	i2c_start_wait(DS1307_ADDRESS + I2C_WRITE);
-	i2c_write(DS1307_SECONDS);
-	i2c_write(0x00);
-	i2c_stop();
+	startBuffer[0] = DS1307_SECONDS;
+	startBuffer[1] = decToBcd(timeInfo->seconds);
+	setupRTCWrite(&transaction, startBuffer, 2);
+	
+	return transferRTC(&transaction);
+}
+
+/*************************************************************************
+ Read battery backed RAM of the RTC. This function waits until the read 
+ operation is completed.
+
+ offset: Start offset within the RTC RAM.
+ 
+ buffer: Buffer to fill with RAM content.
+ 
+ length: Number of bytes to read.
+
+ Return: TRUE if read is successful, otherwise FALSE.
+*************************************************************************/
+UCHAR readRTCMemory(UCHAR offset, PUCHAR buffer, UCHAR length)
+{
+	UCHAR ramRegister = DS1307_RAM + offset;
+	TWI_TRANSACTION transaction;
+	
+	transaction.address = DS1307_ADDRESS;
+	transaction.writeBuffer = &ramRegister;
+	transaction.writeLength = 1;
+	transaction.readBuffer = buffer;
+	transaction.readLength = length;
+	transaction.onComplete = 0;
+	
+	return transferRTC(&transaction);
+}
+
+/*************************************************************************
+ Write battery backed RAM of the RTC. Data is copied into the internal 
+ buffer and the transaction is queued, so this function returns without 
+ waiting for the I2C transfer. This function can be called from interrupt 
+ service routines.
+
+ offset: Start offset within the RTC RAM.
+ 
+ buffer: Data to write.
+ 
+ length: Number of bytes to write.
+
+ Return: TRUE if write is queued, FALSE if previous write is still in 
+		 progress.
+*************************************************************************/
+UCHAR writeRTCMemory(UCHAR offset, PUCHAR buffer, UCHAR length)
+{
+	UCHAR pos;
+	
+	if(!IS_TWI_COMPLETE(&_rtcMemoryTransaction))
+	{
+		return FALSE;
+	}
+	
+	_rtcMemoryBuffer[0] = DS1307_RAM + offset;
+	for(pos = 0; pos < length; pos++)
+	{
+		_rtcMemoryBuffer[pos + 1] = buffer[pos];
+	}
+	
+	_rtcMemoryTransaction.address = DS1307_ADDRESS;
+	_rtcMemoryTransaction.writeBuffer = _rtcMemoryBuffer;
+	_rtcMemoryTransaction.writeLength = length + 1;
+	_rtcMemoryTransaction.readBuffer = 0;
+	_rtcMemoryTransaction.readLength = 0;
+	_rtcMemoryTransaction.onComplete = 0;
+	
+	return twiSubmit(&_rtcMemoryTransaction);
 }
 
 /*************************************************************************
@@ -12,9 +12,29 @@
 #ifndef DS1307_RTC_MODULE_HEADER
 #define DS1307_RTC_MODULE_HEADER
 
+// Size of the battery backed RAM of the DS1307.
+#define DS1307_RAM_SIZE	56
+
+// Number of attempts of the blocking RTC transfers. Attempts are separated by 
+// RTC_RETRY_DELAY milliseconds, doubled on each retry.
+#define RTC_RETRY_LIMIT		3
+#define RTC_RETRY_DELAY		5
+
+// Background time reads are retried after 1, 2, 4 ... seconds up to 
+// 2^RTC_BACKOFF_LIMIT seconds.
+#define RTC_BACKOFF_LIMIT	5
+
 VOID initRTCModule();
+VOID requestSystemTime();
+UCHAR readSystemTime(PTIME timeInfo);
+UCHAR isRTCHalted();
+UCHAR getRTCReadAge();
+VOID restartRTCOscillator();
 VOID getSystemTime(PTIME timeInfo);
-VOID setSystemTime(PTIME timeInfo);
+UCHAR setSystemTime(PTIME timeInfo);
+
+UCHAR readRTCMemory(UCHAR offset, PUCHAR buffer, UCHAR length);
+UCHAR writeRTCMemory(UCHAR offset, PUCHAR buffer, UCHAR length);
 
 UCHAR bcdToDec(UCHAR inVal);
 UCHAR decToBcd(UCHAR inVal);
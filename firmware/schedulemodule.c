@@ -0,0 +1,119 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     schedulemodule.c
+* Info:		Multi-slot light schedule with minute-of-day activity map.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "schedulemodule.h"
+#include "timemodule.h"
+
+// Light state of every minute of the day, bit 0 of the first byte is 00:00.
+UCHAR _scheduleMap[SCHEDULE_MAP_SIZE];
+
+/*************************************************************************
+ Mark specified range of minutes as active in the activity map.
+ 
+ startMinute: First active minute.
+ 
+ endMinute: Minute after the last active minute. This value must be 
+			greater than or equal to startMinute.
+ 
+ Return: None
+*************************************************************************/
+VOID setScheduleRange(UINT startMinute, UINT endMinute)
+{
+	// Set leading bits up to the byte boundary.
+	while((startMinute < endMinute) && (startMinute & 0x07))
+	{
+		_scheduleMap[startMinute >> 3] |= (1 << (startMinute & 0x07));
+		startMinute++;
+	}
+	
+	// Fill complete bytes.
+	while((startMinute + 8) <= endMinute)
+	{
+		_scheduleMap[startMinute >> 3] = 0xFF;
+		startMinute += 8;
+	}
+	
+	// Set remaining trailing bits.
+	while(startMinute < endMinute)
+	{
+		_scheduleMap[startMinute >> 3] |= (1 << (startMinute & 0x07));
+		startMinute++;
+	}
+}
+
+/*************************************************************************
+ Compile all the schedule slots into the minute-of-day activity map. Slots
+ with equal start and end times are disabled. This function should be 
+ called after the schedule is loaded or modified.
+ 
+ onTimes: Light on times of all the schedule slots.
+ 
+ offTimes: Light off times of all the schedule slots.
+ 
+ Return: None
+*************************************************************************/
+VOID compileSchedule(PTIME onTimes, PTIME offTimes)
+{
+	UCHAR slotId;
+	UCHAR index;
+	UINT startMinute;
+	UINT endMinute;
+	
+	// Map is read only by processClock in the main loop context, so it is 
+	// compiled with interrupts enabled.
+	for(index = 0; index < SCHEDULE_MAP_SIZE; index++)
+	{
+		_scheduleMap[index] = 0x00;
+	}
+	
+	for(slotId = 0; slotId < SCHEDULE_SLOTS; slotId++)
+	{
+		startMinute = timeToMinutes(&onTimes[slotId]);
+		endMinute = timeToMinutes(&offTimes[slotId]);
+		
+		if((startMinute >= MINUTES_PER_DAY) || (endMinute >= MINUTES_PER_DAY))
+		{
+			// Ignore slots with invalid time values.
+			continue;
+		}
+		
+		if(startMinute < endMinute)
+		{
+			// Start and end time are defined before midnight.
+			setScheduleRange(startMinute, endMinute);
+		}
+		else if(startMinute > endMinute)
+		{
+			// Start and end time are defined including midnight.
+			setScheduleRange(startMinute, MINUTES_PER_DAY);
+			setScheduleRange(0, endMinute);
+		}
+	}
+}
+
+/*************************************************************************
+ Determine light on / off state for the specified time with a single 
+ bit test in the activity map.
+ 
+ currMinutes: Current time in minutes since midnight.
+ 
+ Return: TRUE if light should open, otherwise this function return FALSE.
+*************************************************************************/
+UCHAR isLightActive(UINT currMinutes)
+{
+	if(currMinutes >= MINUTES_PER_DAY)
+	{
+		return FALSE;
+	}
+	
+	return (_scheduleMap[currMinutes >> 3] & (1 << (currMinutes & 0x07))) ? TRUE : FALSE;
+}
@@ -0,0 +1,23 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     schedulemodule.h
+* Info:		Multi-slot light schedule with minute-of-day activity map.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef SCHEDULE_MODULE_HEADER
+#define SCHEDULE_MODULE_HEADER
+
+#define MINUTES_PER_DAY		1440
+
+// Size of the minute-of-day activity map (1 bit per minute).
+#define SCHEDULE_MAP_SIZE	(MINUTES_PER_DAY / 8)
+
+VOID compileSchedule(PTIME onTimes, PTIME offTimes);
+UCHAR isLightActive(UINT currMinutes);
+
+#endif
@@ -0,0 +1,98 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     stackmodule.c
+* Info:		Startup timer, stack painting and free RAM monitor.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "stackmodule.h"
+#include "halmodule.h"
+
+// Linker symbols: end of the static data (.data and .bss) and top of the 
+// stack. This firmware does not use the heap.
+extern UCHAR _end;
+extern UCHAR __stack;
+
+VOID startBootTimer() __attribute__ ((naked, used, section (".init0")));
+VOID paintStack() __attribute__ ((naked, used, section (".init1")));
+
+/*************************************************************************
+ Start timer1 with the system tick prescaler right after the reset. The 
+ count is read by initTimerModule to measure the C runtime startup. This 
+ function runs from the .init0 section before the stack pointer and the 
+ zero register are initialized, so it is written in assembly.
+
+ Return: None
+*************************************************************************/
+VOID startBootTimer()
+{
+	__asm__ __volatile__
+	(
+		"	ldi r24, %0\n"
+		"	out %1, r24\n"
+		:
+		: "M" (1 << CS11), "I" (_SFR_IO_ADDR(TCCR1B))
+	);
+}
+
+/*************************************************************************
+ Fill RAM between the end of the static data and the top of the stack 
+ with STACK_CANARY. This function runs from the .init1 section before 
+ the stack pointer and the zero register are initialized, so it is 
+ written in assembly.
+
+ Return: None
+*************************************************************************/
+VOID paintStack()
+{
+	__asm__ __volatile__
+	(
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:
+		: "M" (STACK_CANARY)
+	);
+}
+
+/*************************************************************************
+ Get size of the statically allocated RAM (.data and .bss sections).
+
+ Return: Size of the static data in bytes.
+*************************************************************************/
+UINT getStaticRAMSize()
+{
+	return (UINT)&_end - HAL_RAM_START;
+}
+
+/*************************************************************************
+ Get minimum free RAM since the system startup. RAM above the static data
+ is scanned for the paint pattern, and the first overwritten byte marks 
+ the deepest point reached by the stack.
+
+ Return: Minimum number of free bytes between the static data and the 
+		 stack.
+*************************************************************************/
+UINT getFreeRAM()
+{
+	PUCHAR ramPos = &_end;
+	
+	while((ramPos <= &__stack) && (*ramPos == STACK_CANARY))
+	{
+		ramPos++;
+	}
+	
+	return (UINT)(ramPos - &_end);
+}
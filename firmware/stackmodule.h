@@ -0,0 +1,21 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     stackmodule.h
+* Info:		Stack painting and free RAM monitor.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef STACK_MODULE_HEADER
+#define STACK_MODULE_HEADER
+
+// Pattern used to paint the unused RAM during the startup.
+#define STACK_CANARY	0xC5
+
+UINT getStaticRAMSize();
+UINT getFreeRAM();
+
+#endif
@@ -12,14 +12,23 @@
 #ifndef SYSTEM_DEFINITION_HEADER
 #define SYSTEM_DEFINITION_HEADER
 
-// Define base data types.
+// Define base data types. Host build (simulator) keeps the integer sizes 
+// of the AVR (16-bit int and 32-bit long).
 #define VOID	void
 #define CHAR	signed char
 #define UCHAR	unsigned char
 #define PUCHAR	unsigned char*
+#ifdef HAL_HOST
+#define INT		signed short
+#define UINT	unsigned short
+#define UINT32	unsigned int
+#define INT32	signed int
+#else
 #define INT		int
 #define UINT	unsigned int
 #define UINT32	unsigned long
+#define INT32	signed long
+#endif
 
 // Definition for logical TRUE and FALSE
 #define TRUE	0xFF
@@ -43,6 +52,9 @@ struct displayBufferStruct
 #define DISPLAY		struct displayBufferStruct
 #define PDISPLAY	DISPLAY*
 
+// Number of light on / off slots in the daily schedule.
+#define SCHEDULE_SLOTS	4
+
 // Time structure.
 struct timeStruct
 {
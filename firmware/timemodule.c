@@ -36,57 +36,52 @@ VOID sysTimeToDisplayBuffer(PTIME timeData, PDISPLAY displayData)
 }
 
 /*************************************************************************
- Convert specified time structure to 32-bit unsigned integer.
+ Advance specified time data structure by one second.
  
  timeData: Instance of the TIME data structure.
  
- Return: Time as 32-bit unsigned integer.
+ Return: None
 *************************************************************************/
-UINT32 timeToInt32(PTIME timeData)
+VOID addSecond(PTIME timeData)
 {
-	UINT32 tempHour = timeData->hours;
-	UINT32 tempMinute = timeData->minutes;
-	UINT32 tempSeconds = timeData->seconds;
+	if((++timeData->seconds) < 60)
+	{
+		return;
+	}
+	
+	timeData->seconds = 0;
+	if((++timeData->minutes) < 60)
+	{
+		return;
+	}
 	
-	return (tempHour << 16) | (tempMinute << 8) | (tempSeconds);
+	timeData->minutes = 0;
+	if((++timeData->hours) >= 24)
+	{
+		timeData->hours = 0;
+	}
 }
 
 /*************************************************************************
- Determine light on / off state by checking the specified time parameters.
+ Convert specified time structure to number of seconds since midnight.
  
- currTime: Current system time.
+ timeData: Instance of the TIME data structure.
  
- onTime: Light on time.
+ Return: Seconds since midnight.
+*************************************************************************/
+UINT32 timeToSeconds(PTIME timeData)
+{
+	return ((UINT32)timeData->hours * 3600) + ((UINT)timeData->minutes * 60) + timeData->seconds;
+}
+
+/*************************************************************************
+ Convert specified time structure to number of minutes since midnight.
  
- offTime: Light off time.
+ timeData: Instance of the TIME data structure.
  
- Return: TRUE if light should open, otherwise this function return FALSE.
+ Return: Minutes since midnight.
 *************************************************************************/
-UCHAR isLightActive(PTIME currTime, PTIME onTime, PTIME offTime)
+UINT timeToMinutes(PTIME timeData)
 {
-	// Convert specified TIME data structures to 32-bit unsigned integers.
-	UINT32 startTime = timeToInt32(onTime);
-	UINT32 stopTime = timeToInt32(offTime);
-	UINT32 sysTime = timeToInt32(currTime);
-	
-	if (stopTime == startTime)
-	{
-		// Nothing happens if start and end times are equal.
-		return FALSE;
-	}
-	else if (stopTime > startTime)
-	{
-		// Start and end time are defined before midnight.
-		return (sysTime >= startTime) && (sysTime < stopTime) ? TRUE : FALSE;
-	}
-	if (stopTime == 0x00)
-	{
-		// Stop time is set to mid night.
-		return (sysTime < startTime) ? FALSE : TRUE;
-	}
-	else
-	{
-		// Start and end time are defined including midnight.
-		return (sysTime >= startTime) || (sysTime < stopTime) ? TRUE : FALSE;
-	}
+	return ((UINT)timeData->hours * 60) + timeData->minutes;
 }
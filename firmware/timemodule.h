@@ -13,7 +13,8 @@
 #define TIME_MODULE_HEADER
 
 VOID sysTimeToDisplayBuffer(PTIME timeData, PDISPLAY displayData);
-UINT32 timeToInt32(PTIME timeData);
-UCHAR isLightActive(PTIME currTime, PTIME onTime, PTIME offTime);
+VOID addSecond(PTIME timeData);
+UINT32 timeToSeconds(PTIME timeData);
+UINT timeToMinutes(PTIME timeData);
 
 #endif
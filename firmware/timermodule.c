@@ -0,0 +1,246 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     timermodule.c
+* Info:		System tick and software timers.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "timermodule.h"
+#include "halmodule.h"
+
+SOFT_TIMER _timers[TIMER_COUNT];
+UCHAR _timerCount = 0;
+
+// Number of system ticks since the system startup (wraps around). Upper 
+// word extends the count for the microsecond time stamps.
+volatile UINT _systemTicks = 0;
+volatile UINT _systemTicksHigh = 0;
+
+// Earliest deadline of all the active timers.
+UINT _nextDeadline = TIMER_MAX_PERIOD;
+
+// Timer1 count from the reset to the system tick initialization.
+UINT _bootCount = 0;
+
+/*************************************************************************
+ Initialize system tick. Timer1 is configured in CTC mode to generate 
+ TIMER_TICK_RATE compare match interrupts per second. The tick ISR must 
+ call runTimers.
+
+ Return: None
+*************************************************************************/
+VOID initTimerModule()
+{
+	_timerCount = 0;
+	_systemTicks = 0;
+	_systemTicksHigh = 0;
+	_nextDeadline = TIMER_MAX_PERIOD;
+	
+	// Timer1 runs from the startup code (see startBootTimer).
+	_bootCount = HAL_TICK_COUNT();
+	HAL_TICK_INIT(TIMER_COMPARE);
+}
+
+/*************************************************************************
+ Allocate software timer. Timer stays inactive until startTimer is called.
+
+ callback: Function to call on timer expiry.
+
+ Return: Timer ID or TIMER_INVALID if all the timers are allocated.
+*************************************************************************/
+UCHAR createTimer(VOID (*callback)(VOID))
+{
+	if(_timerCount >= TIMER_COUNT)
+	{
+		return TIMER_INVALID;
+	}
+	
+	_timers[_timerCount].callback = callback;
+	_timers[_timerCount].isActive = FALSE;
+	
+	return _timerCount++;
+}
+
+/*************************************************************************
+ Start (or restart) software timer. This function can be called from 
+ timer callbacks.
+
+ timerId: ID of the timer returned by createTimer.
+ 
+ periodMs: Timer period in milliseconds. Period is rounded to the system 
+		   tick and limited to TIMER_MAX_PERIOD ticks.
+ 
+ mode: TIMER_ONE_SHOT or TIMER_PERIODIC.
+
+ Return: None
+*************************************************************************/
+VOID startTimer(UCHAR timerId, UINT periodMs, UCHAR mode)
+{
+	PSOFT_TIMER timer = &_timers[timerId];
+	UINT period = TIMER_MS_TO_TICKS(periodMs);
+	UCHAR sreg = SREG;
+	
+	if(period == 0)
+	{
+		period = 1;
+	}
+	else if(period > TIMER_MAX_PERIOD)
+	{
+		period = TIMER_MAX_PERIOD;
+	}
+	
+	cli();
+	timer->period = period;
+	timer->mode = mode;
+	timer->deadline = _systemTicks + period;
+	timer->isActive = TRUE;
+	
+	if((INT)(timer->deadline - _nextDeadline) < 0)
+	{
+		_nextDeadline = timer->deadline;
+	}
+	SREG = sreg;
+}
+
+/*************************************************************************
+ Stop software timer.
+
+ timerId: ID of the timer returned by createTimer.
+
+ Return: None
+*************************************************************************/
+VOID stopTimer(UCHAR timerId)
+{
+	_timers[timerId].isActive = FALSE;
+}
+
+/*************************************************************************
+ Check state of the software timer.
+
+ timerId: ID of the timer returned by createTimer.
+
+ Return: TRUE if timer is running, otherwise FALSE.
+*************************************************************************/
+UCHAR isTimerActive(UCHAR timerId)
+{
+	return _timers[timerId].isActive;
+}
+
+/*************************************************************************
+ Advance system tick and call the callbacks of the expired timers. This 
+ function must be called from the system tick ISR. If no timer is due, 
+ only the tick counter is updated.
+
+ Return: None
+*************************************************************************/
+VOID runTimers()
+{
+	PSOFT_TIMER timer;
+	UCHAR timerId;
+	
+	_systemTicks++;
+	if(_systemTicks == 0)
+	{
+		_systemTicksHigh++;
+	}
+	
+	if((INT)(_systemTicks - _nextDeadline) < 0)
+	{
+		return;
+	}
+	
+	// Call expired timers and find the next deadline.
+	_nextDeadline = _systemTicks + TIMER_MAX_PERIOD;
+	
+	for(timerId = 0; timerId < _timerCount; timerId++)
+	{
+		timer = &_timers[timerId];
+		
+		if(timer->isActive == FALSE)
+		{
+			continue;
+		}
+		
+		if((INT)(_systemTicks - timer->deadline) >= 0)
+		{
+			if(timer->mode == TIMER_PERIODIC)
+			{
+				timer->deadline += timer->period;
+			}
+			else
+			{
+				timer->isActive = FALSE;
+			}
+			
+			// Callback can restart or stop this timer.
+			timer->callback();
+		}
+		
+		if((timer->isActive == TRUE) && ((INT)(timer->deadline - _nextDeadline) < 0))
+		{
+			_nextDeadline = timer->deadline;
+		}
+	}
+}
+
+/*************************************************************************
+ Get number of system ticks since the system startup.
+
+ Return: System tick counter (wraps around).
+*************************************************************************/
+UINT getSystemTicks()
+{
+	UINT ticks;
+	UCHAR sreg = SREG;
+	
+	cli();
+	ticks = _systemTicks;
+	SREG = sreg;
+	
+	return ticks;
+}
+
+/*************************************************************************
+ Get time since the system startup in microseconds with the resolution of
+ the timer1 clock. Value wraps around at 2^32 microseconds, so the 
+ difference of two time stamps is valid for intervals up to 71 minutes.
+
+ Return: Elapsed time in microseconds.
+*************************************************************************/
+UINT32 getTimerMicroseconds()
+{
+	UINT32 ticks;
+	UINT count;
+	UCHAR sreg = SREG;
+	
+	cli();
+	ticks = ((UINT32)_systemTicksHigh << 16) | _systemTicks;
+	count = HAL_TICK_COUNT();
+	
+	// Compare match is not yet serviced.
+	if(HAL_TICK_PENDING())
+	{
+		ticks++;
+		count = HAL_TICK_COUNT();
+	}
+	SREG = sreg;
+	
+	return (ticks * (1000000UL / TIMER_TICK_RATE)) + (((UINT32)count * TIMER_PRESCALER) / (F_CPU / 1000000UL));
+}
+
+/*************************************************************************
+ Get time since the reset in microseconds. Includes the oscillator 
+ start-up time and the C runtime startup measured by timer1 before the 
+ system tick is initialized.
+
+ Return: Elapsed time in microseconds.
+*************************************************************************/
+UINT32 getBootMicroseconds()
+{
+	return HAL_STARTUP_TIME + ((((UINT32)_bootCount) * TIMER_PRESCALER) / (F_CPU / 1000000UL)) + getTimerMicroseconds();
+}
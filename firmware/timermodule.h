@@ -0,0 +1,71 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     timermodule.h
+* Info:		System tick and software timers.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef TIMER_MODULE_HEADER
+#define TIMER_MODULE_HEADER
+
+#include "displaymodule.h"
+
+// System tick rate in Hz. One digit of the seven segment display is 
+// multiplexed on every tick (2.5 ms).
+#define TIMER_TICK_RATE		(SSD_REFRESH_RATE * SSD_SIZE)
+
+// Timer1 runs in CTC mode with prescaler 8 (CS11).
+#define TIMER_PRESCALER		8
+#define TIMER_COMPARE		((F_CPU / TIMER_PRESCALER / TIMER_TICK_RATE) - 1)
+
+#if ((F_CPU / TIMER_PRESCALER / TIMER_TICK_RATE) < 2) || ((F_CPU / TIMER_PRESCALER / TIMER_TICK_RATE) > 65536)
+#error "TIMER_TICK_RATE is out of range for the Timer1 prescaler."
+#endif
+
+// Convert timer1 count to microseconds.
+#define TIMER_TCNT_TO_US(c)	((UINT)((((UINT32)(c)) * TIMER_PRESCALER) / (F_CPU / 1000000UL)))
+
+// Convert milliseconds to system ticks.
+#define TIMER_MS_TO_TICKS(ms)	((UINT)(((((UINT32)(ms)) * TIMER_TICK_RATE) + 500) / 1000))
+
+// Longest supported timer period in system ticks (~81 s).
+#define TIMER_MAX_PERIOD	0x7FFF
+
+// Number of software timers.
+#define TIMER_COUNT			6
+
+#define TIMER_INVALID		0xFF
+
+// Software timer modes.
+#define TIMER_ONE_SHOT		0x00
+#define TIMER_PERIODIC		0x01
+
+// Software timer. Callback is called from the system tick ISR.
+struct softTimerStruct
+{
+	VOID (*callback)(VOID);
+	UINT deadline;
+	UINT period;
+	UCHAR mode;
+	UCHAR isActive;
+};
+
+#define SOFT_TIMER	struct softTimerStruct
+#define PSOFT_TIMER	SOFT_TIMER*
+
+VOID initTimerModule();
+UCHAR createTimer(VOID (*callback)(VOID));
+VOID startTimer(UCHAR timerId, UINT periodMs, UCHAR mode);
+VOID stopTimer(UCHAR timerId);
+UCHAR isTimerActive(UCHAR timerId);
+VOID runTimers();
+
+UINT getSystemTicks();
+UINT32 getTimerMicroseconds();
+UINT32 getBootMicroseconds();
+
+#endif
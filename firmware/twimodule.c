@@ -0,0 +1,343 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     twimodule.c
+* Info:		Interrupt driven TWI (I2C) master with transaction queue.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "twimodule.h"
+#include "profilemodule.h"
+#include "timermodule.h"
+#include "eventmodule.h"
+#include "halmodule.h"
+
+// TWCR values used by the state machine.
+#define TWCR_START		((1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_NEXT		((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_ACK		((1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_STOP		((1 << TWINT) | (1 << TWSTO) | (1 << TWEN))
+
+PTWI_TRANSACTION _twiQueue[TWI_QUEUE_SIZE];
+volatile UCHAR _twiHead = 0;
+volatile UCHAR _twiTail = 0;
+
+// State of the active transaction.
+UCHAR _twiIndex;
+UCHAR _twiReadPhase;
+UINT _twiStartTick;
+
+// Number of failed and timed out transactions.
+UINT _twiErrorCount = 0;
+
+// Set by the tick ISR when the active transaction is timed out. The bus 
+// is recovered later by processTWITimeout in main loop context.
+volatile UCHAR _twiTimedOut = FALSE;
+
+/*************************************************************************
+ Initialize TWI module for the interrupt driven operation.
+
+ Return: None
+*************************************************************************/
+VOID initTWIModule()
+{
+	// Set TWI clock with prescaler 1.
+	HAL_TWI_INIT(((F_CPU / TWI_SCL_CLOCK) - 16) / 2);
+	
+	_twiHead = 0;
+	_twiTail = 0;
+	_twiTimedOut = FALSE;
+}
+
+/*************************************************************************
+ Issue start condition for the transaction at the head of the queue.
+
+ withStop: Set to TRUE to terminate the previous transaction with a stop
+		   condition before the start condition.
+
+ Return: None
+*************************************************************************/
+VOID twiStartNext(UCHAR withStop)
+{
+	UCHAR pollCount;
+	
+	if(_twiTail == _twiHead)
+	{
+		// Queue is empty, release the bus.
+		HAL_TWI_CONTROL(withStop ? TWCR_STOP : (1 << TWEN));
+		return;
+	}
+	
+	_twiQueue[_twiTail]->status = TWI_BUSY;
+	_twiStartTick = getSystemTicks();
+	_twiIndex = 0;
+	_twiReadPhase = (_twiQueue[_twiTail]->writeLength == 0) ? TRUE : FALSE;
+	
+	if(withStop)
+	{
+		// TWI sends stop condition followed by start condition if both bits are set.
+		HAL_TWI_CONTROL(TWCR_START | (1 << TWSTO));
+	}
+	else
+	{
+		// Wait until previous stop condition is executed and bus released. 
+		// If the stop condition is stuck, the start condition is issued 
+		// anyway and the bus is recovered after the transaction timeout.
+		for(pollCount = 0; (pollCount < TWI_STOP_POLL_LIMIT) && HAL_TWI_IS_STOPPING(); pollCount++);
+		HAL_TWI_CONTROL(TWCR_START);
+	}
+}
+
+/*************************************************************************
+ Complete active transaction and start the next queued transaction.
+
+ status: Completion status of the active transaction.
+ 
+ withStop: Set to TRUE to terminate the transaction with a stop condition.
+
+ Return: None
+*************************************************************************/
+VOID twiComplete(UCHAR status, UCHAR withStop)
+{
+	PTWI_TRANSACTION transaction = _twiQueue[_twiTail];
+	
+	_twiTail = (_twiTail + 1) & (TWI_QUEUE_SIZE - 1);
+	transaction->status = status;
+	
+	if(status != TWI_DONE)
+	{
+		_twiErrorCount++;
+	}
+	
+	if(transaction->onComplete)
+	{
+		transaction->onComplete(status);
+	}
+	
+	twiStartNext(withStop);
+}
+
+/*************************************************************************
+ Release the bus from a slave which holds SDA low. TWI is disabled and 
+ SCL is clocked manually until the slave releases SDA, and then the bus 
+ is terminated with a stop condition. Lines are driven as open drain 
+ outputs (low by setting the DDR bit) with the external pull-ups.
+
+ Return: None
+*************************************************************************/
+VOID recoverTWIBus()
+{
+	UCHAR clockCount;
+	
+	HAL_TWI_CONTROL(0x00);
+	HAL_TWI_RELEASE_PINS();
+	
+	for(clockCount = 0; (clockCount < TWI_RECOVERY_CLOCKS) && !HAL_TWI_SDA_STATE(); clockCount++)
+	{
+		HAL_TWI_SCL_LOW();
+		HAL_DELAY_US(TWI_RECOVERY_DELAY);
+		HAL_TWI_SCL_RELEASE();
+		HAL_DELAY_US(TWI_RECOVERY_DELAY);
+	}
+	
+	// Stop condition: SDA goes high while SCL is high.
+	HAL_TWI_SCL_LOW();
+	HAL_DELAY_US(TWI_RECOVERY_DELAY);
+	HAL_TWI_SDA_LOW();
+	HAL_DELAY_US(TWI_RECOVERY_DELAY);
+	HAL_TWI_SCL_RELEASE();
+	HAL_DELAY_US(TWI_RECOVERY_DELAY);
+	HAL_TWI_SDA_RELEASE();
+	HAL_DELAY_US(TWI_RECOVERY_DELAY);
+	
+	HAL_TWI_CONTROL(1 << TWEN);
+}
+
+/*************************************************************************
+ Detect active transaction which is not completed within 
+ TWI_TIMEOUT_PERIOD. TWI is disabled to stop the state machine, and the 
+ bus recovery is deferred to the main loop (WORK_TWI) because it takes 
+ too long for the ISR. This function should be called from the system 
+ tick ISR.
+
+ Return: None
+*************************************************************************/
+VOID checkTWITimeout()
+{
+	if(_twiTimedOut || (_twiTail == _twiHead) || (_twiQueue[_twiTail]->status != TWI_BUSY))
+	{
+		return;
+	}
+	
+	if((UINT)(getSystemTicks() - _twiStartTick) > TIMER_MS_TO_TICKS(TWI_TIMEOUT_PERIOD))
+	{
+		HAL_TWI_CONTROL(0x00);
+		_twiTimedOut = TRUE;
+		postWork(WORK_TWI);
+	}
+}
+
+/*************************************************************************
+ Recover the bus after a timeout detected by checkTWITimeout, abort the 
+ timed out transaction and start the next queued transaction. This 
+ function runs in main loop context (WORK_TWI and twiWait).
+
+ Return: None
+*************************************************************************/
+VOID processTWITimeout()
+{
+	UCHAR sreg;
+	
+	if(!_twiTimedOut)
+	{
+		return;
+	}
+	
+	// Bus is bit-banged with interrupts enabled. TWI is disabled, so the 
+	// queue is not advanced until the transaction is aborted below.
+	recoverTWIBus();
+	
+	sreg = SREG;
+	cli();
+	_twiTimedOut = FALSE;
+	twiComplete(TWI_TIMEOUT, FALSE);
+	SREG = sreg;
+}
+
+/*************************************************************************
+ Get number of failed TWI transactions since the system startup. 
+ Transactions completed with NACK, bus error or timeout are counted.
+
+ Return: Number of failed transactions.
+*************************************************************************/
+UINT getTWIErrorCount()
+{
+	UINT errorCount;
+	UCHAR sreg = SREG;
+	
+	cli();
+	errorCount = _twiErrorCount;
+	SREG = sreg;
+	
+	return errorCount;
+}
+
+/*************************************************************************
+ Add transaction into the TWI queue. Transaction starts immediately if 
+ the bus is idle.
+
+ transaction: Instance of the transaction to submit.
+
+ Return: TRUE if transaction is queued, FALSE if the queue is full.
+*************************************************************************/
+UCHAR twiSubmit(PTWI_TRANSACTION transaction)
+{
+	UCHAR nextHead;
+	UCHAR isIdle;
+	UCHAR sreg = SREG;
+	
+	cli();
+	
+	nextHead = (_twiHead + 1) & (TWI_QUEUE_SIZE - 1);
+	if(nextHead == _twiTail)
+	{
+		SREG = sreg;
+		return FALSE;
+	}
+	
+	isIdle = (_twiHead == _twiTail);
+	transaction->status = TWI_PENDING;
+	_twiQueue[_twiHead] = transaction;
+	_twiHead = nextHead;
+	
+	// Start the transaction if the bus is idle.
+	if(isIdle)
+	{
+		twiStartNext(FALSE);
+	}
+	
+	SREG = sreg;
+	return TRUE;
+}
+
+/*************************************************************************
+ Wait until the specified transaction is completed. Global interrupts 
+ must be enabled to call this function. Wait time is bounded by the 
+ transaction timeout of the queued transactions.
+
+ transaction: Instance of the submitted transaction.
+
+ Return: Completion status of the transaction.
+*************************************************************************/
+UCHAR twiWait(PTWI_TRANSACTION transaction)
+{
+	while(!IS_TWI_COMPLETE(transaction))
+	{
+		// Deferred work does not run while the main loop is blocked here.
+		processTWITimeout();
+		HAL_WAIT();
+	}
+	return transaction->status;
+}
+
+/*************************************************************************
+ Interrupt service routine for TWI. This routine drives the active
+ transaction one bus event at a time.
+ 
+ Return: None
+*************************************************************************/
+ISR(TWI_vect)
+{
+	PTWI_TRANSACTION transaction = _twiQueue[_twiTail];
+	PROFILE_ISR_BEGIN(PROFILE_NO_LATENCY);
+	
+	switch(HAL_TWI_STATUS())
+	{
+		case TW_START:
+		case TW_REP_START:
+			// Send device address with the transfer direction.
+			HAL_TWI_WRITE(transaction->address | (_twiReadPhase ? TW_READ : TW_WRITE));
+			HAL_TWI_CONTROL(TWCR_NEXT);
+			break;
+		case TW_MT_SLA_ACK:
+		case TW_MT_DATA_ACK:
+			if(_twiIndex < transaction->writeLength)
+			{
+				HAL_TWI_WRITE(transaction->writeBuffer[_twiIndex++]);
+				HAL_TWI_CONTROL(TWCR_NEXT);
+			}
+			else if(transaction->readLength > 0)
+			{
+				// Switch to read phase with repeated start.
+				_twiIndex = 0;
+				_twiReadPhase = TRUE;
+				HAL_TWI_CONTROL(TWCR_START);
+			}
+			else
+			{
+				twiComplete(TWI_DONE, TRUE);
+			}
+			break;
+		case TW_MR_DATA_ACK:
+			transaction->readBuffer[_twiIndex++] = HAL_TWI_READ();
+			// Fall through to request next byte.
+		case TW_MR_SLA_ACK:
+			// Acknowledge all the bytes except the last one.
+			HAL_TWI_CONTROL(((_twiIndex + 1) < transaction->readLength) ? TWCR_ACK : TWCR_NEXT);
+			break;
+		case TW_MR_DATA_NACK:
+			transaction->readBuffer[_twiIndex++] = HAL_TWI_READ();
+			twiComplete(TWI_DONE, TRUE);
+			break;
+		default:
+			// Address or data NACK, arbitration lost and bus errors.
+			twiComplete(TWI_ERROR, TRUE);
+			break;
+	}
+	
+	PROFILE_ISR_END(PROFILE_TWI);
+}
@@ -0,0 +1,69 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     twimodule.h
+* Info:		Interrupt driven TWI (I2C) master with transaction queue.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef TWI_MODULE_HEADER
+#define TWI_MODULE_HEADER
+
+// I2C clock in Hz.
+#define TWI_SCL_CLOCK	100000L
+
+// Maximum number of queued transactions. This value must be a power of 2.
+#define TWI_QUEUE_SIZE	4
+
+// Longest allowed transaction time in milliseconds. Transactions which are
+// not completed within this period are aborted and the bus is recovered.
+#define TWI_TIMEOUT_PERIOD	25
+
+// Maximum number of polls of the stop condition before the next start.
+#define TWI_STOP_POLL_LIMIT	200
+
+// Half period of the manually generated SCL clock in microseconds.
+#define TWI_RECOVERY_DELAY	5
+
+// Number of SCL clocks to release a slave which holds SDA low.
+#define TWI_RECOVERY_CLOCKS	9
+
+// Transaction status codes.
+#define TWI_IDLE		0x00
+#define TWI_PENDING		0x01
+#define TWI_BUSY		0x02
+#define TWI_DONE		0x03
+#define TWI_ERROR		0x04
+#define TWI_TIMEOUT		0x05
+
+// I2C transaction. Bytes in writeBuffer are sent first, and then readLength
+// bytes are received into readBuffer after a repeated start. The transaction
+// and the buffers must stay valid until the transaction is completed.
+struct twiTransactionStruct
+{
+	UCHAR address;
+	PUCHAR writeBuffer;
+	UCHAR writeLength;
+	PUCHAR readBuffer;
+	UCHAR readLength;
+	VOID (*onComplete)(UCHAR status);
+	volatile UCHAR status;
+};
+
+#define TWI_TRANSACTION		struct twiTransactionStruct
+#define PTWI_TRANSACTION	TWI_TRANSACTION*
+
+#define IS_TWI_COMPLETE(t)	(((t)->status != TWI_PENDING) && ((t)->status != TWI_BUSY))
+#define IS_TWI_FAILED(t)	(((t)->status == TWI_ERROR) || ((t)->status == TWI_TIMEOUT))
+
+VOID initTWIModule();
+UCHAR twiSubmit(PTWI_TRANSACTION transaction);
+UCHAR twiWait(PTWI_TRANSACTION transaction);
+VOID checkTWITimeout();
+VOID processTWITimeout();
+UINT getTWIErrorCount();
+
+#endif
@@ -0,0 +1,131 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     watchdogmodule.c
+* Info:		Task supervision with watchdog timer and reset fault log.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "watchdogmodule.h"
+#include "memmodule.h"
+#include "halmodule.h"
+
+// Task state is not cleared by the startup code, so it is available to 
+// the fault log after the reset.
+UINT _taskSignature __attribute__ ((section (".noinit")));
+volatile UCHAR _currentTask __attribute__ ((section (".noinit")));
+volatile UINT32 _uptime __attribute__ ((section (".noinit")));
+
+// Tasks checked in since the last watchdog reset.
+UCHAR _taskCheckIn;
+
+// Content of MCUCSR at the system startup.
+UCHAR _resetCause;
+
+/*************************************************************************
+ Save the cause of the last reset into the fault log and start the 
+ watchdog timer. Power-on resets are not logged. This function should be
+ called with global interrupts enabled.
+
+ Return: None
+*************************************************************************/
+VOID initWatchdogModule()
+{
+	FAULT_RECORD record;
+	
+	// Reset flags are cleared to detect the cause of the next reset.
+	_resetCause = HAL_RESET_CAUSE();
+	HAL_CLEAR_RESET_CAUSE();
+	
+	if((_resetCause & (1 << PORF)) == 0x00)
+	{
+		record.resetCause = _resetCause;
+		
+		// Task state is lost if the RAM content is not retained.
+		if(_taskSignature == WATCHDOG_SIGNATURE)
+		{
+			record.taskId = _currentTask;
+			record.uptime = _uptime;
+		}
+		else
+		{
+			record.taskId = TASK_NONE;
+			record.uptime = 0;
+		}
+		
+		saveFaultRecord(&record);
+	}
+	
+	_taskSignature = WATCHDOG_SIGNATURE;
+	_currentTask = TASK_BOOT;
+	_uptime = 0;
+	_taskCheckIn = 0;
+	
+	HAL_WDT_ENABLE();
+}
+
+/*************************************************************************
+ Mark specified task as running and check it in with the watchdog 
+ supervisor. Watchdog is reset once all the WATCHDOG_TASKS are checked 
+ in. This function can be called from interrupt service routines.
+
+ taskId: Identifier of the task (TASK_xxx).
+
+ Return: Identifier of the task which was running before this call.
+*************************************************************************/
+UCHAR enterTask(UCHAR taskId)
+{
+	UCHAR lastTask = _currentTask;
+	UCHAR sreg = SREG;
+	
+	cli();
+	
+	_currentTask = taskId;
+	_taskCheckIn |= (1 << taskId);
+	
+	if((_taskCheckIn & WATCHDOG_TASKS) == WATCHDOG_TASKS)
+	{
+		HAL_WDT_RESET();
+		_taskCheckIn = 0;
+	}
+	
+	SREG = sreg;
+	return lastTask;
+}
+
+/*************************************************************************
+ Restore the running task after the completion of the current task.
+
+ taskId: Task identifier returned by enterTask.
+
+ Return: None
+*************************************************************************/
+VOID leaveTask(UCHAR taskId)
+{
+	_currentTask = taskId;
+}
+
+/*************************************************************************
+ Advance system uptime by one second. This function is called from the 
+ software clock timer.
+
+ Return: None
+*************************************************************************/
+VOID updateUptime()
+{
+	_uptime++;
+}
+
+/*************************************************************************
+ Get cause of the last reset.
+
+ Return: Content of MCUCSR register at the system startup.
+*************************************************************************/
+UCHAR getResetCause()
+{
+	return _resetCause;
+}
@@ -0,0 +1,39 @@
+/*************************************************************************
+* Title:	ATmega8 Firmware for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     watchdogmodule.h
+* Info:		Task supervision with watchdog timer and reset fault log.
+* Compiler: AVR GCC 5.4.0 (AVR 8-bit GNU Toolchain 3.6.1)
+* Target:   ATmega8L / ATmega8A
+**************************************************************************/
+
+#ifndef WATCHDOG_MODULE_HEADER
+#define WATCHDOG_MODULE_HEADER
+
+// Supervised task identifiers. Identifier of the running task is recorded
+// in the fault log on watchdog, brownout and external resets.
+#define TASK_BOOT		0
+#define TASK_MAIN		1
+#define TASK_TICK		2
+#define TASK_CLOCK		3
+#define TASK_NVRAM		4
+
+// Task identifier of the fault records without a valid task state.
+#define TASK_NONE		0xFF
+
+// Tasks which must check in within every watchdog period (about 2s). 
+// Watchdog is reset only after all these tasks are checked in.
+#define WATCHDOG_TASKS	((1 << TASK_MAIN) | (1 << TASK_TICK) | (1 << TASK_CLOCK))
+
+// Marks the task state (kept in .noinit section) as valid.
+#define WATCHDOG_SIGNATURE	0x5AA5
+
+VOID initWatchdogModule();
+UCHAR enterTask(UCHAR taskId);
+VOID leaveTask(UCHAR taskId);
+VOID updateUptime();
+UCHAR getResetCause();
+
+#endif
@@ -0,0 +1,764 @@
+/*************************************************************************
+* Title:	Cycle count benchmark for programmable light controller.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     benchrun.c
+* Info:		Runs the ATmega8 firmware image under simavr and measures the
+*			cycle counts of the interrupt service routines, selected
+*			functions and the main loop. Fails if any measured item
+*			exceeds its cycle budget or is not run at all. Budgets are
+*			calibrated from the measured maxima (-B), and the measured
+*			averages are written for the host simulator (-w).
+* Compiler: GCC (Linux host) with libsimavr
+* Target:   Linux host
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "avr_ioport.h"
+#include "avr_twi.h"
+
+#include "sysbasedef.h"
+
+// Default length of the benchmark run in seconds (simulated). Menu opened
+// by the scripted long press closes on SLEEP_TIMEOUT at ~24.3 s, and 
+// getSystemTime is not called before that.
+#define BENCH_DEFAULT_TIME	30
+
+// Default margin of the calibrated budgets over the measured maxima in
+// percent.
+#define BENCH_DEFAULT_MARGIN	25
+
+// Option button is held at 2 s for 1.5 s to open the settings menu. Menu
+// closes on the idle timeout and the firmware reads the RTC time with
+// getSystemTime.
+#define BENCH_PRESS_TIME	2000
+#define BENCH_RELEASE_TIME	3500
+
+// Interrupt response (4 cycles) and the RJMP of the vector table (2 cycles)
+// are spent before the first instruction of the ISR.
+#define BENCH_VECTOR_CYCLES	6
+
+// Maximum nesting depth of the measured items.
+#define BENCH_STACK_SIZE	16
+
+#define BENCH_NO_BUDGET		0xFFFFFFFFUL
+#define BENCH_DS1307		0xD0
+
+// Measured item types.
+#define BENCH_ISR			0
+#define BENCH_FUNCTION		1
+#define BENCH_MAIN_LOOP		2
+
+struct benchItemStruct
+{
+	const char* name;
+	const char* symbol;
+	UCHAR type;
+	UINT32 address;
+	UINT32 budget;
+	UINT32 calls;
+	UINT32 minCycles;
+	UINT32 maxCycles;
+	unsigned long long totalCycles;
+};
+
+#define BENCH_ITEM	struct benchItemStruct
+#define PBENCH_ITEM	BENCH_ITEM*
+
+// Active measurement on the call stack of the simulated MCU.
+struct benchFrameStruct
+{
+	PBENCH_ITEM item;
+	UINT sp;
+	avr_cycle_count_t start;
+	avr_cycle_count_t nested;
+};
+
+#define BENCH_FRAME	struct benchFrameStruct
+
+// Minimal DS1307 on the simulated TWI bus. Time counts from 12:00:00.
+struct benchRTCStruct
+{
+	avr_irq_t* irq;
+	UCHAR registers[64];
+	UCHAR pointer;
+	UCHAR isSelected;
+	UCHAR isPointerSet;
+};
+
+#define BENCH_RTC	struct benchRTCStruct
+
+// Vector numbers are the ATmega8 vector table entries of the firmware ISRs.
+BENCH_ITEM _benchItems[] =
+{
+	{"TIMER1_COMPA_vect", "__vector_6", BENCH_ISR},
+	{"EE_RDY_vect", "__vector_15", BENCH_ISR},
+	{"TWI_vect", "__vector_17", BENCH_ISR},
+	{"getSystemTime", "getSystemTime", BENCH_FUNCTION},
+	{"isLightActive", "isLightActive", BENCH_FUNCTION},
+	{"setDisplayValueSet", "setDisplayValueSet", BENCH_FUNCTION},
+	{"main loop", NULL, BENCH_MAIN_LOOP}
+};
+
+#define BENCH_ITEM_COUNT	(sizeof(_benchItems) / sizeof(BENCH_ITEM))
+#define BENCH_MAIN_ITEM		(&_benchItems[BENCH_ITEM_COUNT - 1])
+
+BENCH_FRAME _benchStack[BENCH_STACK_SIZE];
+UCHAR _benchDepth = 0;
+UCHAR _benchIsrDepth = 0;
+BENCH_RTC _benchRTC;
+
+/*************************************************************************
+ Add cycle count sample to the measured item.
+
+ item: Measured item.
+
+ cycles: Number of CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID benchRecord(PBENCH_ITEM item, avr_cycle_count_t cycles)
+{
+	if((item->calls == 0) || (cycles < item->minCycles))
+	{
+		item->minCycles = (UINT32)cycles;
+	}
+
+	if(cycles > item->maxCycles)
+	{
+		item->maxCycles = (UINT32)cycles;
+	}
+
+	item->totalCycles += cycles;
+	item->calls++;
+}
+
+/*************************************************************************
+ Find measured item by name.
+
+ name: Item name or symbol name.
+
+ Return: Pointer to the item or NULL if item is not found.
+*************************************************************************/
+PBENCH_ITEM benchFindItem(const char* name)
+{
+	UCHAR itemId;
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		if((strcmp(_benchItems[itemId].name, name) == 0) ||
+			(_benchItems[itemId].symbol && (strcmp(_benchItems[itemId].symbol, name) == 0)))
+		{
+			return &_benchItems[itemId];
+		}
+	}
+
+	return NULL;
+}
+
+/*************************************************************************
+ Load function addresses from the symbol table (avr-nm output).
+
+ fileName: Symbol table file.
+
+ Return: TRUE if all the ISRs and functions are found, otherwise FALSE.
+*************************************************************************/
+UCHAR benchLoadSymbols(const char* fileName)
+{
+	FILE* symbolFile = fopen(fileName, "r");
+	char line[256];
+	char name[200];
+	char type;
+	unsigned long address;
+	PBENCH_ITEM item;
+	UCHAR itemId;
+	UCHAR isValid = TRUE;
+
+	if(symbolFile == NULL)
+	{
+		perror(fileName);
+		return FALSE;
+	}
+
+	while(fgets(line, sizeof(line), symbolFile))
+	{
+		if(sscanf(line, "%lx %c %199s", &address, &type, name) != 3)
+		{
+			continue;
+		}
+
+		if(((type == 'T') || (type == 't')) && ((item = benchFindItem(name)) != NULL) && item->symbol)
+		{
+			item->address = (UINT32)address;
+		}
+	}
+
+	fclose(symbolFile);
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		if(_benchItems[itemId].symbol && (_benchItems[itemId].address == 0))
+		{
+			fprintf(stderr, "symbol not found: %s\n", _benchItems[itemId].symbol);
+			isValid = FALSE;
+		}
+	}
+
+	return isValid;
+}
+
+/*************************************************************************
+ Load cycle budgets. Each line of the budget file holds the item name
+ followed by the maximum number of cycles. Lines starting with # are
+ comments.
+
+ fileName: Budget file.
+
+ Return: TRUE if the file is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR benchLoadBudgets(const char* fileName)
+{
+	FILE* budgetFile = fopen(fileName, "r");
+	char line[256];
+	char name[200];
+	unsigned long budget;
+	char* separator;
+	PBENCH_ITEM item;
+
+	if(budgetFile == NULL)
+	{
+		perror(fileName);
+		return FALSE;
+	}
+
+	while(fgets(line, sizeof(line), budgetFile))
+	{
+		if((line[0] == '#') || ((separator = strrchr(line, ' ')) == NULL))
+		{
+			continue;
+		}
+
+		*separator = 0;
+		if((sscanf(separator + 1, "%lu", &budget) != 1) || (sscanf(line, "%199[^\n]", name) != 1))
+		{
+			continue;
+		}
+
+		if((item = benchFindItem(name)) == NULL)
+		{
+			fprintf(stderr, "unknown budget item: %s\n", name);
+			fclose(budgetFile);
+			return FALSE;
+		}
+
+		item->budget = (UINT32)budget;
+	}
+
+	fclose(budgetFile);
+	return TRUE;
+}
+
+/*************************************************************************
+ Get stack pointer of the simulated MCU.
+
+ avr: Simulated MCU.
+
+ Return: Stack pointer.
+*************************************************************************/
+UINT benchGetSP(avr_t* avr)
+{
+	return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+/*************************************************************************
+ Track entry and exit of the measured items after each instruction. Item
+ is entered when the PC reaches its first instruction and left when the
+ stack pointer rises above the entry value (return address is popped).
+ ISR cycles are excluded from the items they interrupt.
+
+ avr: Simulated MCU.
+
+ Return: None
+*************************************************************************/
+VOID benchTrace(avr_t* avr)
+{
+	UINT sp = benchGetSP(avr);
+	avr_cycle_count_t cycles;
+	BENCH_FRAME* frame;
+	UCHAR itemId;
+
+	// Close completed items (including tail calls).
+	while((_benchDepth > 0) && (sp > _benchStack[_benchDepth - 1].sp))
+	{
+		frame = &_benchStack[--_benchDepth];
+		cycles = avr->cycle - frame->start;
+
+		if(frame->item->type == BENCH_ISR)
+		{
+			_benchIsrDepth--;
+			benchRecord(frame->item, cycles + BENCH_VECTOR_CYCLES);
+
+			if(_benchDepth > 0)
+			{
+				_benchStack[_benchDepth - 1].nested += cycles + BENCH_VECTOR_CYCLES;
+			}
+		}
+		else
+		{
+			benchRecord(frame->item, cycles - frame->nested);
+
+			if(_benchDepth > 0)
+			{
+				_benchStack[_benchDepth - 1].nested += frame->nested;
+			}
+		}
+	}
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		if(!_benchItems[itemId].symbol || (avr->pc != _benchItems[itemId].address))
+		{
+			continue;
+		}
+
+		// Ignore loops back to the first instruction of the active item.
+		if((_benchDepth > 0) && (_benchStack[_benchDepth - 1].item == &_benchItems[itemId]) &&
+			(_benchStack[_benchDepth - 1].sp == sp))
+		{
+			break;
+		}
+
+		if(_benchDepth < BENCH_STACK_SIZE)
+		{
+			frame = &_benchStack[_benchDepth++];
+			frame->item = &_benchItems[itemId];
+			frame->sp = sp;
+			frame->start = avr->cycle;
+			frame->nested = 0;
+
+			if(frame->item->type == BENCH_ISR)
+			{
+				_benchIsrDepth++;
+			}
+		}
+
+		break;
+	}
+}
+
+/*************************************************************************
+ Update time keeper registers of the RTC model from the simulated time.
+
+ avr: Simulated MCU.
+
+ Return: None
+*************************************************************************/
+VOID benchUpdateRTC(avr_t* avr)
+{
+	unsigned long seconds = (unsigned long)(avr->cycle / avr->frequency) + (12UL * 3600UL);
+
+	_benchRTC.registers[0] = (((seconds % 60) / 10) << 4) | ((seconds % 60) % 10);
+	_benchRTC.registers[1] = ((((seconds / 60) % 60) / 10) << 4) | (((seconds / 60) % 60) % 10);
+	_benchRTC.registers[2] = ((((seconds / 3600) % 24) / 10) << 4) | (((seconds / 3600) % 24) % 10);
+}
+
+/*************************************************************************
+ Handle TWI bus messages of the simulated MCU (DS1307 slave).
+
+ irq: TWI output IRQ.
+
+ value: TWI message.
+
+ param: Simulated MCU.
+
+ Return: None
+*************************************************************************/
+VOID benchRTCHook(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	avr_t* avr = (avr_t*)param;
+	avr_twi_msg_irq_t msg;
+
+	msg.u.v = value;
+
+	if(msg.u.twi.msg & TWI_COND_STOP)
+	{
+		_benchRTC.isSelected = FALSE;
+	}
+
+	if(msg.u.twi.msg & TWI_COND_START)
+	{
+		_benchRTC.isSelected = ((msg.u.twi.addr & 0xFE) == BENCH_DS1307) ? TRUE : FALSE;
+		_benchRTC.isPointerSet = (msg.u.twi.addr & 0x01) ? TRUE : FALSE;
+
+		if(_benchRTC.isSelected)
+		{
+			benchUpdateRTC(avr);
+			avr_raise_irq(_benchRTC.irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, msg.u.twi.addr, 1));
+		}
+	}
+
+	if(_benchRTC.isSelected == FALSE)
+	{
+		return;
+	}
+
+	if(msg.u.twi.msg & TWI_COND_WRITE)
+	{
+		avr_raise_irq(_benchRTC.irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, msg.u.twi.addr, 1));
+
+		if(_benchRTC.isPointerSet == FALSE)
+		{
+			_benchRTC.pointer = msg.u.twi.data & 0x3F;
+			_benchRTC.isPointerSet = TRUE;
+		}
+		else
+		{
+			_benchRTC.registers[_benchRTC.pointer] = msg.u.twi.data;
+			_benchRTC.pointer = (_benchRTC.pointer + 1) & 0x3F;
+		}
+	}
+
+	if(msg.u.twi.msg & TWI_COND_READ)
+	{
+		avr_raise_irq(_benchRTC.irq + TWI_IRQ_INPUT,
+			avr_twi_irq_msg(TWI_COND_READ, msg.u.twi.addr, _benchRTC.registers[_benchRTC.pointer]));
+		_benchRTC.pointer = (_benchRTC.pointer + 1) & 0x3F;
+	}
+}
+
+/*************************************************************************
+ Attach DS1307 model to the TWI peripheral of the simulated MCU.
+
+ avr: Simulated MCU.
+
+ Return: None
+*************************************************************************/
+VOID benchAttachRTC(avr_t* avr)
+{
+	static const char* irqNames[2] = {"8>ds1307.out", "32<ds1307.in"};
+
+	memset(&_benchRTC, 0, sizeof(_benchRTC));
+	_benchRTC.irq = avr_alloc_irq(&avr->irq_pool, 0, 2, irqNames);
+
+	avr_irq_register_notify(_benchRTC.irq + TWI_IRQ_OUTPUT, benchRTCHook, avr);
+	avr_connect_irq(_benchRTC.irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+	avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), _benchRTC.irq + TWI_IRQ_OUTPUT);
+}
+
+/*************************************************************************
+ Set state of the push button (PB0 - PB2, active low).
+
+ avr: Simulated MCU.
+
+ buttonId: Button pin number.
+
+ isPressed: TRUE to press the button.
+
+ Return: None
+*************************************************************************/
+VOID benchSetButton(avr_t* avr, UCHAR buttonId, UCHAR isPressed)
+{
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), buttonId), isPressed ? 0 : 1);
+}
+
+/*************************************************************************
+ Write calibrated cycle budgets. Budget of each item is its measured 
+ maximum plus the margin.
+
+ fileName: Budget file.
+ 
+ margin: Margin over the measured maximum in percent.
+ 
+ runTime: Length of the benchmark run in seconds.
+
+ Return: TRUE if the file is written, otherwise FALSE.
+*************************************************************************/
+UCHAR benchWriteBudgets(const char* fileName, unsigned int margin, unsigned int runTime)
+{
+	FILE* budgetFile = fopen(fileName, "w");
+	UCHAR itemId;
+	PBENCH_ITEM item;
+
+	if(budgetFile == NULL)
+	{
+		perror(fileName);
+		return FALSE;
+	}
+
+	fprintf(budgetFile, "# Cycle budgets of the benchmark items (item name followed by the maximum\n");
+	fprintf(budgetFile, "# number of CPU cycles). System tick runs at 400 Hz, every 2.5 ms (10000\n");
+	fprintf(budgetFile, "# cycles at 4 MHz). Generated by make calibrate from a %u s run: measured\n", runTime);
+	fprintf(budgetFile, "# maximum plus %u %% margin.\n", margin);
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		item = &_benchItems[itemId];
+		if(item->calls > 0)
+		{
+			fprintf(budgetFile, "%s %lu\n", item->name, 
+				(unsigned long)(((unsigned long long)item->maxCycles * (100 + margin) + 99) / 100));
+		}
+	}
+
+	fclose(budgetFile);
+	return TRUE;
+}
+
+/*************************************************************************
+ Write measured average and maximum cycle counts of the items. Host 
+ simulator charges these costs to the virtual time (lightsim -c).
+
+ fileName: Cycle count file.
+
+ Return: TRUE if the file is written, otherwise FALSE.
+*************************************************************************/
+UCHAR benchWriteCycles(const char* fileName)
+{
+	FILE* cycleFile = fopen(fileName, "w");
+	UCHAR itemId;
+	PBENCH_ITEM item;
+
+	if(cycleFile == NULL)
+	{
+		perror(fileName);
+		return FALSE;
+	}
+
+	fprintf(cycleFile, "# Measured CPU cycles: item name, average and maximum.\n");
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		item = &_benchItems[itemId];
+		if(item->calls > 0)
+		{
+			fprintf(cycleFile, "%s %lu %lu\n", item->name, 
+				(unsigned long)(item->totalCycles / item->calls), (unsigned long)item->maxCycles);
+		}
+	}
+
+	fclose(cycleFile);
+	return TRUE;
+}
+
+/*************************************************************************
+ Print benchmark results and check the budgets. Items which are not run
+ fail, because their budget is not verified. Items without budget are 
+ only reported unless the budget is required.
+
+ isBudgetRequired: Set to TRUE to fail the items without budget.
+
+ Return: TRUE if all the items are run and within the budget, otherwise 
+		 FALSE.
+*************************************************************************/
+UCHAR benchReport(UCHAR isBudgetRequired)
+{
+	UCHAR itemId;
+	UCHAR isPassed = TRUE;
+	PBENCH_ITEM item;
+	const char* status;
+
+	printf("%-20s %8s %8s %8s %8s %8s  %s\n", "item", "calls", "min", "avg", "max", "budget", "status");
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		item = &_benchItems[itemId];
+
+		if(item->calls == 0)
+		{
+			printf("%-20s %8s %8s %8s %8s %8s  %s\n", item->name, "-", "-", "-", "-", "-", "NOT RUN");
+			isPassed = FALSE;
+			continue;
+		}
+
+		status = "ok";
+		if((item->budget != BENCH_NO_BUDGET) && (item->maxCycles > item->budget))
+		{
+			status = "OVER BUDGET";
+			isPassed = FALSE;
+		}
+		else if(item->budget == BENCH_NO_BUDGET)
+		{
+			status = isBudgetRequired ? "NO BUDGET" : "no budget";
+			isPassed = isBudgetRequired ? FALSE : isPassed;
+		}
+
+		printf("%-20s %8lu %8lu %8lu %8lu ", item->name, (unsigned long)item->calls,
+			(unsigned long)item->minCycles, (unsigned long)(item->totalCycles / item->calls),
+			(unsigned long)item->maxCycles);
+
+		if(item->budget == BENCH_NO_BUDGET)
+		{
+			printf("%8s  %s\n", "-", status);
+		}
+		else
+		{
+			printf("%8lu  %s\n", (unsigned long)item->budget, status);
+		}
+	}
+
+	printf("result: %s\n", isPassed ? "PASS" : "FAIL");
+	return isPassed;
+}
+
+int main(int argc, char** argv)
+{
+	elf_firmware_t firmware;
+	avr_t* avr;
+	const char* symbolFile = NULL;
+	const char* budgetFile = NULL;
+	const char* calibrateFile = NULL;
+	const char* cycleFile = NULL;
+	unsigned int runTime = BENCH_DEFAULT_TIME;
+	unsigned int margin = BENCH_DEFAULT_MARGIN;
+	avr_cycle_count_t endCycle;
+	avr_cycle_count_t mainCycles = 0;
+	avr_cycle_count_t lastCycle;
+	UCHAR isBooted = FALSE;
+	UCHAR isBudgetRequired = FALSE;
+	UCHAR isRunning;
+	UCHAR isPressed;
+	UCHAR wasPressed = FALSE;
+	UCHAR itemId;
+	int state;
+	int option;
+
+	while((option = getopt(argc, argv, "s:b:rB:m:w:t:h")) != -1)
+	{
+		switch(option)
+		{
+			case 's':
+				symbolFile = optarg;
+				break;
+			case 'b':
+				budgetFile = optarg;
+				break;
+			case 'r':
+				isBudgetRequired = TRUE;
+				break;
+			case 'B':
+				calibrateFile = optarg;
+				break;
+			case 'm':
+				margin = (unsigned int)atoi(optarg);
+				break;
+			case 'w':
+				cycleFile = optarg;
+				break;
+			case 't':
+				runTime = (unsigned int)atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s -s symbols [-b budgets [-r] | -B budgets [-m margin]] [-w cycles] [-t seconds] firmware.elf\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if((optind >= argc) || (symbolFile == NULL))
+	{
+		fprintf(stderr, "usage: %s -s symbols [-b budgets [-r] | -B budgets [-m margin]] [-w cycles] [-t seconds] firmware.elf\n", argv[0]);
+		return 2;
+	}
+
+	for(itemId = 0; itemId < BENCH_ITEM_COUNT; itemId++)
+	{
+		_benchItems[itemId].budget = BENCH_NO_BUDGET;
+	}
+
+	if((benchLoadSymbols(symbolFile) == FALSE) || (budgetFile && (benchLoadBudgets(budgetFile) == FALSE)))
+	{
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(argv[optind], &firmware) != 0)
+	{
+		fprintf(stderr, "unable to load %s\n", argv[optind]);
+		return 2;
+	}
+
+	strcpy(firmware.mmcu, "atmega8");
+	firmware.frequency = F_CPU;
+
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if(avr == NULL)
+	{
+		fprintf(stderr, "atmega8 is not supported by this simavr build\n");
+		return 2;
+	}
+
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr->frequency = F_CPU;
+
+	benchAttachRTC(avr);
+	for(itemId = 0; itemId < 3; itemId++)
+	{
+		benchSetButton(avr, itemId, FALSE);
+	}
+
+	endCycle = (avr_cycle_count_t)runTime * F_CPU;
+
+	while(avr->cycle < endCycle)
+	{
+		// Script the option button long press.
+		isPressed = ((avr->cycle >= ((avr_cycle_count_t)BENCH_PRESS_TIME * (F_CPU / 1000))) &&
+			(avr->cycle < ((avr_cycle_count_t)BENCH_RELEASE_TIME * (F_CPU / 1000)))) ? TRUE : FALSE;
+		if(isPressed != wasPressed)
+		{
+			benchSetButton(avr, 0, isPressed);
+			wasPressed = isPressed;
+		}
+
+		isRunning = (avr->state == cpu_Running) ? TRUE : FALSE;
+		lastCycle = avr->cycle;
+
+		state = avr_run(avr);
+		if((state == cpu_Done) || (state == cpu_Crashed))
+		{
+			fprintf(stderr, "firmware stopped at 0x%04x\n", (unsigned int)avr->pc);
+			return 2;
+		}
+
+		// Main loop pass is the main context work between two sleeps.
+		if(isRunning && (_benchIsrDepth == 0))
+		{
+			mainCycles += avr->cycle - lastCycle;
+		}
+
+		benchTrace(avr);
+
+		if(avr->state == cpu_Sleeping)
+		{
+			// Startup code runs until the first sleep.
+			if(isBooted && (mainCycles > 0))
+			{
+				benchRecord(BENCH_MAIN_ITEM, mainCycles);
+			}
+
+			isBooted = TRUE;
+			mainCycles = 0;
+		}
+	}
+
+	// Budgets calibrated by this run are not checked.
+	if(benchReport((isBudgetRequired && !calibrateFile) ? TRUE : FALSE) == FALSE)
+	{
+		return 1;
+	}
+	
+	if((calibrateFile && (benchWriteBudgets(calibrateFile, margin, runTime) == FALSE)) || 
+		(cycleFile && (benchWriteCycles(cycleFile) == FALSE)))
+	{
+		return 2;
+	}
+
+	return 0;
+}
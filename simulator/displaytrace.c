@@ -0,0 +1,266 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     displaytrace.c
+* Info:		Seven segment display waveform capture and flicker analyzer.
+*			Digit select (PORTC) and segment (PORTD) writes are captured
+*			with the virtual time stamp and reduced into per digit on
+*			time, refresh rate, duty cycle skew and ghosting windows.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "halmodule.h"
+#include "displaytrace.h"
+
+#include <string.h>
+
+/*************************************************************************
+ Initialize display trace.
+
+ trace: Display trace.
+
+ start: Start of the analysis window in CPU clock cycles.
+
+ end: End of the analysis window in CPU clock cycles.
+
+ capture: File to write the raw port writes (CSV) or NULL.
+
+ Return: None
+*************************************************************************/
+VOID initDisplayTrace(PDISPLAY_TRACE trace, UINT64 start, UINT64 end, FILE* capture)
+{
+	UCHAR digitId;
+
+	memset(trace, 0, sizeof(DISPLAY_TRACE));
+
+	trace->start = start;
+	trace->end = end;
+	trace->capture = capture;
+	trace->lastChange = start;
+	trace->lastSegmentChange = start;
+
+	for(digitId = 0; digitId < SSD_SIZE; digitId++)
+	{
+		trace->lastEnable[digitId] = TRACE_NO_TIME;
+		trace->windowStart[digitId] = start;
+	}
+
+	if(capture)
+	{
+		fprintf(capture, "cycle,time_us,port,value\n");
+	}
+}
+
+/*************************************************************************
+ Accumulate output state up to the specified time.
+
+ trace: Display trace.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID updateDisplayTrace(PDISPLAY_TRACE trace, UINT64 now)
+{
+	UINT64 elapsed;
+	UCHAR digitId;
+	UCHAR activeCount = 0;
+
+	if(now > trace->end)
+	{
+		now = trace->end;
+	}
+
+	if(now <= trace->lastChange)
+	{
+		return;
+	}
+
+	elapsed = now - trace->lastChange;
+	trace->lastChange = now;
+
+	for(digitId = 0; digitId < SSD_SIZE; digitId++)
+	{
+		if(trace->digits & (1 << digitId))
+		{
+			activeCount++;
+			trace->onTime[digitId] += elapsed;
+
+			if(trace->segments)
+			{
+				trace->litTime[digitId] += elapsed;
+			}
+		}
+	}
+
+	// More than one digit selected shows the same segments on all of them.
+	if(activeCount > 1)
+	{
+		trace->overlapTime += elapsed;
+	}
+}
+
+/*************************************************************************
+ Record port write. Only the writes within the analysis window are used.
+
+ trace: Display trace.
+
+ now: Virtual time of the write in CPU clock cycles.
+
+ port: Port number (HOST_PORTx).
+
+ value: Value written into the port.
+
+ Return: None
+*************************************************************************/
+VOID recordDisplayTrace(PDISPLAY_TRACE trace, UINT64 now, UCHAR port, UCHAR value)
+{
+	UCHAR digitId;
+	UCHAR digits;
+	UINT64 gap;
+	UINT64 ghostStart;
+
+	if((port != HOST_PORTC) && (port != HOST_PORTD))
+	{
+		return;
+	}
+
+	// State before the window is tracked, but not accumulated.
+	if(now < trace->start)
+	{
+		if(port == HOST_PORTC)
+		{
+			trace->digits = value & TRACE_DIGIT_MASK;
+		}
+		else
+		{
+			trace->segments = value;
+		}
+
+		return;
+	}
+
+	if(now >= trace->end)
+	{
+		return;
+	}
+
+	updateDisplayTrace(trace, now);
+	trace->writes++;
+
+	if(trace->capture)
+	{
+		fprintf(trace->capture, "%llu,%.2f,%c,0x%02X\n", now, (double)now / (F_CPU / 1000000UL),
+			(port == HOST_PORTC) ? 'C' : 'D', value);
+	}
+
+	if(port == HOST_PORTD)
+	{
+		if(value == trace->segments)
+		{
+			return;
+		}
+
+		// Segments changed while a digit is lit. The old segment pattern was
+		// shown on the digit since the later of its select and the previous
+		// segment change.
+		for(digitId = 0; digitId < SSD_SIZE; digitId++)
+		{
+			if(trace->digits & (1 << digitId))
+			{
+				ghostStart = (trace->lastSegmentChange > trace->windowStart[digitId]) ?
+					trace->lastSegmentChange : trace->windowStart[digitId];
+				trace->ghostCount++;
+				trace->ghostTime += now - ghostStart;
+			}
+		}
+
+		trace->segments = value;
+		trace->lastSegmentChange = now;
+		return;
+	}
+
+	digits = value & TRACE_DIGIT_MASK;
+
+	for(digitId = 0; digitId < SSD_SIZE; digitId++)
+	{
+		if((digits & (1 << digitId)) && !(trace->digits & (1 << digitId)))
+		{
+			trace->enables[digitId]++;
+			trace->windowStart[digitId] = now;
+
+			if(trace->lastEnable[digitId] != TRACE_NO_TIME)
+			{
+				gap = now - trace->lastEnable[digitId];
+				if(gap > trace->maxGap[digitId])
+				{
+					trace->maxGap[digitId] = gap;
+				}
+			}
+
+			trace->lastEnable[digitId] = now;
+		}
+	}
+
+	trace->digits = digits;
+}
+
+/*************************************************************************
+ Print display analysis report.
+
+ trace: Display trace.
+
+ now: End of the simulation in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID printDisplayReport(PDISPLAY_TRACE trace, UINT64 now)
+{
+	UCHAR digitId;
+	UINT64 window;
+	double duty;
+	double minDuty = 1.0;
+	double maxDuty = 0.0;
+	double sumDuty = 0.0;
+
+	updateDisplayTrace(trace, now);
+
+	if(trace->capture)
+	{
+		fclose(trace->capture);
+		trace->capture = NULL;
+	}
+
+	window = ((now < trace->end) ? now : trace->end);
+	window = (window > trace->start) ? (window - trace->start) : 0;
+
+	if(window == 0)
+	{
+		printf("display window  : empty\n");
+		return;
+	}
+
+	printf("display window  : %.3f s, %u port writes\n", (double)window / F_CPU, trace->writes);
+	printf("  digit   on time     duty   lit time   refresh   max gap\n");
+
+	for(digitId = 0; digitId < SSD_SIZE; digitId++)
+	{
+		duty = (double)trace->onTime[digitId] / window;
+		sumDuty += duty;
+		minDuty = (duty < minDuty) ? duty : minDuty;
+		maxDuty = (duty > maxDuty) ? duty : maxDuty;
+
+		printf("  %5u %8.3f s %7.2f%% %8.3f s %7.1f Hz %7.2f ms\n", digitId, (double)trace->onTime[digitId] / F_CPU,
+			duty * 100.0, (double)trace->litTime[digitId] / F_CPU, trace->enables[digitId] / ((double)window / F_CPU),
+			(double)trace->maxGap[digitId] * 1000.0 / F_CPU);
+	}
+
+	printf("duty skew       : %.3f %% (max - min relative to mean)\n",
+		(sumDuty > 0.0) ? ((maxDuty - minDuty) * 100.0 * SSD_SIZE / sumDuty) : 0.0);
+	printf("digit overlap   : %.3f ms\n", (double)trace->overlapTime * 1000.0 / F_CPU);
+	printf("ghost windows   : %u, %.3f ms\n", trace->ghostCount, (double)trace->ghostTime * 1000.0 / F_CPU);
+}
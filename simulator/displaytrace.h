@@ -0,0 +1,53 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     displaytrace.h
+* Info:		Seven segment display waveform capture and flicker analyzer.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#ifndef DISPLAY_TRACE_HEADER
+#define DISPLAY_TRACE_HEADER
+
+#include "sysbasedef.h"
+#include "displaymodule.h"
+
+#include <stdio.h>
+
+// Digit select outputs on PORTC (PC0 - PC3).
+#define TRACE_DIGIT_MASK	((1 << SSD_SIZE) - 1)
+
+#define TRACE_NO_TIME		0xFFFFFFFFFFFFFFFFULL
+
+struct displayTraceStruct
+{
+	UINT64 start;
+	UINT64 end;
+	FILE* capture;
+	UCHAR digits;
+	UCHAR segments;
+	UINT64 lastChange;
+	UINT64 lastSegmentChange;
+	UINT32 writes;
+	UINT64 windowStart[SSD_SIZE];
+	UINT64 lastEnable[SSD_SIZE];
+	UINT64 onTime[SSD_SIZE];
+	UINT64 litTime[SSD_SIZE];
+	UINT32 enables[SSD_SIZE];
+	UINT64 maxGap[SSD_SIZE];
+	UINT64 overlapTime;
+	UINT32 ghostCount;
+	UINT64 ghostTime;
+};
+
+#define DISPLAY_TRACE	struct displayTraceStruct
+#define PDISPLAY_TRACE	DISPLAY_TRACE*
+
+VOID initDisplayTrace(PDISPLAY_TRACE trace, UINT64 start, UINT64 end, FILE* capture);
+VOID recordDisplayTrace(PDISPLAY_TRACE trace, UINT64 now, UCHAR port, UCHAR value);
+VOID printDisplayReport(PDISPLAY_TRACE trace, UINT64 now);
+
+#endif
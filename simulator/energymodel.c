@@ -0,0 +1,216 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     energymodel.c
+* Info:		Supply current estimation and per mode energy budget. The
+*			estimated current of the 5V logic and the LED module is
+*			integrated over the virtual time and reported at the 24V
+*			supply input for each operating mode.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "halmodule.h"
+#include "energymodel.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Display digit select outputs on PORTC (PC0 - PC3).
+#define ENERGY_DIGIT_MASK	((1 << SSD_SIZE) - 1)
+
+const char* _energyModeNames[ENERGY_MODE_COUNT] = {"menu open", "light active", "display on", "display blank"};
+
+/*************************************************************************
+ Initialize energy model. Integration starts from the current virtual
+ time.
+
+ model: Energy model.
+
+ Return: None
+*************************************************************************/
+VOID initEnergyModel(PENERGY_MODEL model)
+{
+	memset(model, 0, sizeof(ENERGY_MODEL));
+
+	model->lastUpdate = hostGetCycles();
+	model->lastTwiCycles = hostTwiBusyCycles();
+	hostGetActivity(&model->lastSleepCycles, &model->lastInterrupts, &model->lastWakeups);
+	model->mode = ENERGY_MODE_BLANK;
+}
+
+/*************************************************************************
+ Count lit segments of the selected digits.
+
+ digits: Digit select outputs.
+
+ segments: Segment outputs.
+
+ Return: Number of lit LEDs.
+*************************************************************************/
+UCHAR energyLitSegments(UCHAR digits, UCHAR segments)
+{
+	return __builtin_popcount(digits & ENERGY_DIGIT_MASK) * __builtin_popcount(segments);
+}
+
+/*************************************************************************
+ Integrate supply current from the last update up to the specified time
+ with the output states of the last update, and then latch the new mode
+ and the light output.
+
+ model: Energy model.
+
+ now: Current virtual time in CPU clock cycles.
+
+ mode: Current operating mode (ENERGY_MODE_x).
+
+ lightDuty: Current duty cycle of the master light (0 - 255).
+
+ Return: None
+*************************************************************************/
+VOID updateEnergyModel(PENERGY_MODEL model, UINT64 now, UCHAR mode, UCHAR lightDuty)
+{
+	UINT64 elapsed;
+	UINT64 sleepCycles;
+	UINT64 activeCycles;
+	UINT64 twiCycles;
+	UINT32 interrupts;
+	UINT32 wakeups;
+	double logicCurrent;
+
+	hostGetActivity(&sleepCycles, &interrupts, &wakeups);
+	twiCycles = hostTwiBusyCycles();
+
+	if(now > model->lastUpdate)
+	{
+		elapsed = now - model->lastUpdate;
+
+		// ISRs, main loop passes and busy waits are charged to the virtual 
+		// time (halhost.c), so the CPU is active whenever it is not asleep.
+		activeCycles = elapsed - (sleepCycles - model->lastSleepCycles);
+
+		// Charge of the logic rail in mA x cycles.
+		logicCurrent = (activeCycles * ENERGY_CPU_ACTIVE) + ((elapsed - activeCycles) * ENERGY_CPU_IDLE);
+		logicCurrent += (twiCycles - model->lastTwiCycles) * ENERGY_TWI_ACTIVE;
+		logicCurrent += elapsed * (ENERGY_RTC_STANDBY + (energyLitSegments(model->digits, model->segments) * ENERGY_SEGMENT));
+
+		if(model->portB & ENERGY_SLEEP_LED_PIN)
+		{
+			logicCurrent += elapsed * ENERGY_SLEEP_LED;
+		}
+
+		// Logic rail is reported at the 24V input of the buck converter.
+		model->logicCharge[model->mode] += (logicCurrent * ENERGY_LOGIC_VOLTAGE) / (ENERGY_SUPPLY_VOLTAGE * ENERGY_BUCK_EFFICIENCY);
+		model->logicCharge[model->mode] += elapsed * ENERGY_BUCK_QUIESCENT;
+		model->lightCharge[model->mode] += (elapsed * ENERGY_LIGHT * model->lightDuty) / 255.0;
+
+		model->modeCycles[model->mode] += elapsed;
+		model->activeCycles += activeCycles;
+		model->totalCycles += elapsed;
+		model->interrupts += interrupts - model->lastInterrupts;
+		model->wakeups += wakeups - model->lastWakeups;
+
+		model->lastUpdate = now;
+		model->lastSleepCycles = sleepCycles;
+		model->lastInterrupts = interrupts;
+		model->lastWakeups = wakeups;
+		model->lastTwiCycles = twiCycles;
+	}
+
+	model->mode = mode;
+	model->lightDuty = lightDuty;
+}
+
+/*************************************************************************
+ Record port write. Time since the last update is integrated with the
+ previous port state only if the write changes the estimated current, 
+ so the display refresh of a blank display costs nothing.
+
+ model: Energy model.
+
+ now: Virtual time of the write in CPU clock cycles.
+
+ port: Port number (HOST_PORTx).
+
+ value: Value written into the port.
+
+ Return: None
+*************************************************************************/
+VOID recordEnergyPort(PENERGY_MODEL model, UINT64 now, UCHAR port, UCHAR value)
+{
+	UCHAR digits = model->digits;
+	UCHAR segments = model->segments;
+	UCHAR portB = model->portB;
+
+	switch(port)
+	{
+		case HOST_PORTB:
+			portB = value;
+			break;
+		case HOST_PORTC:
+			digits = value;
+			break;
+		case HOST_PORTD:
+			segments = value;
+			break;
+	}
+
+	// Digit select writes of a blank display do not change the current.
+	if(((portB ^ model->portB) & ENERGY_SLEEP_LED_PIN) || ((segments | model->segments) &&
+		(energyLitSegments(digits, segments) != energyLitSegments(model->digits, model->segments))))
+	{
+		updateEnergyModel(model, now, model->mode, model->lightDuty);
+	}
+
+	model->digits = digits;
+	model->segments = segments;
+	model->portB = portB;
+}
+
+/*************************************************************************
+ Print energy budget report. Charge of each mode is normalized to a day
+ of the simulated time.
+
+ model: Energy model.
+
+ Return: None
+*************************************************************************/
+VOID printEnergyReport(PENERGY_MODEL model)
+{
+	UCHAR mode;
+	double days;
+	double hours;
+	double logic;
+	double light;
+	double totalCharge = 0.0;
+
+	if(model->totalCycles == 0)
+	{
+		printf("energy model    : no data\n");
+		return;
+	}
+
+	days = (double)model->totalCycles / ((double)F_CPU * 86400.0);
+
+	printf("energy model    : %.0fV supply, CPU active %.3f %%, %.1f interrupts/s, %.1f wake ups/s\n", 
+		ENERGY_SUPPLY_VOLTAGE, (double)model->activeCycles * 100.0 / model->totalCycles,
+		model->interrupts / ((double)model->totalCycles / F_CPU), model->wakeups / ((double)model->totalCycles / F_CPU));
+	printf("  mode            h/day   logic mA   light mA     mAh/day\n");
+
+	for(mode = 0; mode < ENERGY_MODE_COUNT; mode++)
+	{
+		hours = (double)model->modeCycles[mode] / ((double)F_CPU * 3600.0);
+		logic = (model->modeCycles[mode] > 0) ? (model->logicCharge[mode] / model->modeCycles[mode]) : 0.0;
+		light = (model->modeCycles[mode] > 0) ? (model->lightCharge[mode] / model->modeCycles[mode]) : 0.0;
+		totalCharge += model->logicCharge[mode] + model->lightCharge[mode];
+
+		printf("  %-13s %7.3f %10.2f %10.2f %11.2f\n", _energyModeNames[mode], hours / days, logic, light,
+			((model->logicCharge[mode] + model->lightCharge[mode]) / ((double)F_CPU * 3600.0)) / days);
+	}
+
+	printf("  %-13s %7.3f %21s %11.2f (%.2f Wh/day)\n", "total", 24.0, "", (totalCharge / ((double)F_CPU * 3600.0)) / days,
+		((totalCharge / ((double)F_CPU * 3600.0)) / days) * ENERGY_SUPPLY_VOLTAGE / 1000.0);
+}
@@ -0,0 +1,77 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     energymodel.h
+* Info:		Supply current estimation and per mode energy budget.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#ifndef ENERGY_MODEL_HEADER
+#define ENERGY_MODEL_HEADER
+
+#include "sysbasedef.h"
+
+// Operating modes of the energy report. Modes are exclusive and the
+// first matching mode is selected in this order: menu open, light
+// active, display on and display blank.
+#define ENERGY_MODE_MENU		0
+#define ENERGY_MODE_LIGHT		1
+#define ENERGY_MODE_DISPLAY		2
+#define ENERGY_MODE_BLANK		3
+#define ENERGY_MODE_COUNT		4
+
+// Supply rails. Logic (5V) is generated by the MC34063 buck converter
+// from the 24V input which also drives the LED module.
+#define ENERGY_SUPPLY_VOLTAGE	24.0
+#define ENERGY_LOGIC_VOLTAGE	5.0
+#define ENERGY_BUCK_EFFICIENCY	0.75
+#define ENERGY_BUCK_QUIESCENT	2.5
+
+// Estimated currents in mA. ATmega8L at 4MHz / 5V in active and idle
+// modes, DS1307 standby and active (bus) current including the 4.7K
+// pull-ups, one segment through 330R, sleep LED through 560R and the LED
+// module limited by Q5 with 2.2R sense resistor.
+#define ENERGY_CPU_ACTIVE		5.0
+#define ENERGY_CPU_IDLE			2.0
+#define ENERGY_RTC_STANDBY		0.2
+#define ENERGY_TWI_ACTIVE		2.5
+#define ENERGY_SEGMENT			8.5
+#define ENERGY_SLEEP_LED		5.4
+#define ENERGY_LIGHT			295.0
+
+// Sleep LED output on PORTB (PB4).
+#define ENERGY_SLEEP_LED_PIN	0x10
+
+struct energyModelStruct
+{
+	UINT64 lastUpdate;
+	UINT64 lastSleepCycles;
+	UINT32 lastInterrupts;
+	UINT32 lastWakeups;
+	UINT64 lastTwiCycles;
+	UCHAR digits;
+	UCHAR segments;
+	UCHAR portB;
+	UCHAR lightDuty;
+	UCHAR mode;
+	UINT64 activeCycles;
+	UINT64 totalCycles;
+	UINT32 interrupts;
+	UINT32 wakeups;
+	UINT64 modeCycles[ENERGY_MODE_COUNT];
+	double logicCharge[ENERGY_MODE_COUNT];
+	double lightCharge[ENERGY_MODE_COUNT];
+};
+
+#define ENERGY_MODEL	struct energyModelStruct
+#define PENERGY_MODEL	ENERGY_MODEL*
+
+VOID initEnergyModel(PENERGY_MODEL model);
+VOID updateEnergyModel(PENERGY_MODEL model, UINT64 now, UCHAR mode, UCHAR lightDuty);
+VOID recordEnergyPort(PENERGY_MODEL model, UINT64 now, UCHAR port, UCHAR value);
+VOID printEnergyReport(PENERGY_MODEL model);
+
+#endif
@@ -0,0 +1,1195 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     halhost.c
+* Info:		Linux host backend of the hardware abstraction layer. This
+*			module models the ATmega8 peripherals used by the firmware
+*			on a virtual CPU clock.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "halmodule.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Pending TWI bus operations.
+#define TWI_OP_NONE		0
+#define TWI_OP_START	1
+#define TWI_OP_ADDRESS	2
+#define TWI_OP_WRITE	3
+#define TWI_OP_READ		4
+
+// Maximum number of interrupts serviced on a single wake up.
+#define HOST_DISPATCH_LIMIT	16
+
+UCHAR SREG = 0;
+
+// Virtual CPU clock and system control state.
+UINT64 _hostCycles;
+UCHAR _hostResetCause;
+UCHAR _wdtEnabled;
+UINT64 _wdtDeadline;
+
+// CPU cycle costs (HOST_COST_x), names match the benchmark items.
+const char* _hostCostNames[HOST_COST_COUNT] = {"TIMER1_COMPA_vect", "EE_RDY_vect", "TWI_vect", "main loop"};
+UINT64 _hostCosts[HOST_COST_COUNT] = {400, 150, 120, 150};
+
+// CPU activity counters for the energy model.
+UCHAR _hostSleeping;
+UINT64 _hostSleepCycles;
+UINT32 _hostInterrupts;
+UINT32 _hostWakeups;
+
+// Ports and push buttons (1 = pressed).
+UCHAR _hostPorts[HOST_PORT_COUNT];
+UCHAR _hostButtons;
+VOID (*_portTrace)(UINT64 now, UCHAR port, UCHAR value) = 0;
+
+// Last time the firmware drove the sleep LED (every main loop pass).
+UINT64 _sleepLedTime;
+
+// Timer1 system tick.
+UINT64 _tickPeriod;
+UINT64 _tickLast;
+UINT64 _tickNext;
+UCHAR _tickFlag;
+
+// Timer2 PWM.
+UCHAR _pwmDuty;
+UCHAR _pwmConnected;
+
+// TWI peripheral and the virtual bus.
+UCHAR _twiEnabled;
+UCHAR _twiControl;
+UCHAR _twiInterrupt;
+UCHAR _twiStatus;
+UCHAR _twiData;
+UCHAR _twiBitRate;
+UCHAR _twiOperation;
+UINT64 _twiDone;
+UCHAR _twiBusOwned;
+UCHAR _twiReadMode;
+UCHAR _twiSDA;
+UCHAR _twiSCL;
+PHOST_TWI_DEVICE _twiActive;
+PHOST_TWI_DEVICE _twiDevices[HOST_TWI_DEVICES];
+UCHAR _twiDeviceCount = 0;
+UINT64 _twiBusyCycles;
+
+// EEPROM content is kept across the resets.
+UCHAR _eeprom[HAL_EEPROM_SIZE];
+UCHAR _eepromErased = FALSE;
+UINT _eepromAddress;
+UINT64 _eepromReady;
+UCHAR _eepromIRQ;
+UINT32 _eepromWrites;
+
+/*************************************************************************
+ Reset virtual MCU. All the peripherals are set to the reset state, the
+ virtual clock starts from zero and the EEPROM content is kept. TWI
+ devices stay attached to the bus.
+
+ resetCause: Initial content of the MCUCSR register.
+
+ Return: None
+*************************************************************************/
+VOID hostReset(UCHAR resetCause)
+{
+	if(_eepromErased == FALSE)
+	{
+		memset(_eeprom, 0xFF, sizeof(_eeprom));
+		_eepromErased = TRUE;
+	}
+
+	SREG = 0;
+	_hostCycles = 0;
+	_hostResetCause = resetCause;
+	_wdtEnabled = FALSE;
+	_wdtDeadline = HOST_NEVER;
+
+	_hostSleeping = FALSE;
+	_hostSleepCycles = 0;
+	_hostInterrupts = 0;
+	_hostWakeups = 0;
+
+	memset(_hostPorts, 0, sizeof(_hostPorts));
+	_hostButtons = 0;
+	_sleepLedTime = HOST_NEVER;
+
+	_tickPeriod = 0;
+	_tickLast = 0;
+	_tickNext = HOST_NEVER;
+	_tickFlag = FALSE;
+
+	_pwmDuty = 0;
+	_pwmConnected = FALSE;
+
+	_twiEnabled = FALSE;
+	_twiControl = 0;
+	_twiInterrupt = FALSE;
+	_twiStatus = TW_NO_INFO;
+	_twiData = 0xFF;
+	_twiBitRate = 0;
+	_twiOperation = TWI_OP_NONE;
+	_twiDone = HOST_NEVER;
+	_twiBusOwned = FALSE;
+	_twiReadMode = FALSE;
+	_twiSDA = TRUE;
+	_twiSCL = TRUE;
+	_twiActive = 0;
+	_twiBusyCycles = 0;
+
+	_eepromAddress = 0;
+	_eepromReady = 0;
+	_eepromIRQ = FALSE;
+	_eepromWrites = 0;
+}
+
+/*************************************************************************
+ Get virtual CPU clock.
+
+ Return: Number of CPU clock cycles since the reset.
+*************************************************************************/
+UINT64 hostGetCycles()
+{
+	return _hostCycles;
+}
+
+/*************************************************************************
+ Load CPU cycle costs from the benchmark output. Each line holds the item
+ name followed by the average and the maximum cycle count, and the 
+ average is charged. Lines starting with # and unknown items are skipped.
+
+ fileName: Cycle count file (bench/build/cycles.txt).
+
+ Return: TRUE if the file is loaded, otherwise FALSE.
+*************************************************************************/
+UCHAR hostLoadCosts(const char* fileName)
+{
+	FILE* costFile = fopen(fileName, "r");
+	char line[256];
+	char* separator;
+	unsigned long average;
+	UCHAR costId;
+
+	if(costFile == NULL)
+	{
+		perror(fileName);
+		return FALSE;
+	}
+
+	while(fgets(line, sizeof(line), costFile))
+	{
+		// Drop the maximum, and then split the name and the average.
+		if((line[0] == '#') || ((separator = strrchr(line, ' ')) == NULL))
+		{
+			continue;
+		}
+
+		*separator = 0;
+		if(((separator = strrchr(line, ' ')) == NULL) || (sscanf(separator + 1, "%lu", &average) != 1))
+		{
+			continue;
+		}
+
+		*separator = 0;
+		for(costId = 0; costId < HOST_COST_COUNT; costId++)
+		{
+			if(strcmp(line, _hostCostNames[costId]) == 0)
+			{
+				_hostCosts[costId] = average;
+			}
+		}
+	}
+
+	fclose(costFile);
+	return TRUE;
+}
+
+/*************************************************************************
+ Call interrupt service routine with global interrupts disabled, as the
+ MCU does on interrupt entry. Entry cycles are charged before the ISR 
+ runs, and the rest of the ISR cost after it returns.
+
+ vector: Interrupt service routine.
+
+ costId: Cycle cost of the ISR (HOST_COST_x).
+
+ Return: None
+*************************************************************************/
+VOID hostCallVector(VOID (*vector)(VOID), UCHAR costId)
+{
+	UCHAR sreg = SREG;
+	UINT64 start = _hostCycles;
+
+	_hostInterrupts++;
+
+	SREG &= 0x7F;
+	_hostCycles += HOST_ISR_ENTRY_CYCLES;
+	vector();
+
+	if((_hostCycles - start) < _hostCosts[costId])
+	{
+		_hostCycles = start + _hostCosts[costId];
+	}
+
+	SREG = sreg;
+}
+
+/*************************************************************************
+ Complete TWI bus operation and raise the TWI interrupt flag.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiComplete()
+{
+	UCHAR deviceId;
+	UCHAR isAck;
+
+	switch(_twiOperation)
+	{
+		case TWI_OP_START:
+			_twiStatus = _twiBusOwned ? TW_REP_START : TW_START;
+			_twiBusOwned = TRUE;
+			_twiActive = 0;
+			break;
+		case TWI_OP_ADDRESS:
+			_twiReadMode = _twiData & TW_READ;
+			_twiActive = 0;
+
+			for(deviceId = 0; deviceId < _twiDeviceCount; deviceId++)
+			{
+				if(_twiDevices[deviceId]->address == (_twiData & 0xFE))
+				{
+					if(_twiDevices[deviceId]->start(_twiDevices[deviceId]->context, _twiReadMode))
+					{
+						_twiActive = _twiDevices[deviceId];
+					}
+
+					break;
+				}
+			}
+
+			if(_twiReadMode)
+			{
+				_twiStatus = _twiActive ? TW_MR_SLA_ACK : TW_MR_SLA_NACK;
+			}
+			else
+			{
+				_twiStatus = _twiActive ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+			}
+			break;
+		case TWI_OP_WRITE:
+			isAck = _twiActive ? _twiActive->write(_twiActive->context, _twiData) : FALSE;
+			_twiStatus = isAck ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+			break;
+		case TWI_OP_READ:
+			isAck = (_twiControl & (1 << TWEA)) ? TRUE : FALSE;
+			_twiData = _twiActive ? _twiActive->read(_twiActive->context, isAck) : 0xFF;
+			_twiStatus = isAck ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+			break;
+	}
+
+	_twiOperation = TWI_OP_NONE;
+	_twiDone = HOST_NEVER;
+	_twiInterrupt = TRUE;
+}
+
+/*************************************************************************
+ Release the virtual TWI bus with a stop condition.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiStop()
+{
+	UCHAR deviceId;
+
+	for(deviceId = 0; deviceId < _twiDeviceCount; deviceId++)
+	{
+		if(_twiDevices[deviceId]->stop)
+		{
+			_twiDevices[deviceId]->stop(_twiDevices[deviceId]->context);
+		}
+	}
+
+	_twiBusOwned = FALSE;
+	_twiActive = 0;
+}
+
+/*************************************************************************
+ Get state of the SDA line. SDA is low if the master or any of the 
+ devices holds it low.
+
+ Return: TRUE if the line is high, otherwise FALSE.
+*************************************************************************/
+UCHAR hostTwiBusSDA()
+{
+	UCHAR deviceId;
+
+	for(deviceId = 0; deviceId < _twiDeviceCount; deviceId++)
+	{
+		if(_twiDevices[deviceId]->sda && !_twiDevices[deviceId]->sda(_twiDevices[deviceId]->context))
+		{
+			return FALSE;
+		}
+	}
+
+	return _twiSDA;
+}
+
+/*************************************************************************
+ Update state of the peripherals up to the current virtual time.
+
+ Return: None
+*************************************************************************/
+VOID hostUpdate()
+{
+	while(_tickNext <= _hostCycles)
+	{
+		_tickFlag = TRUE;
+		_tickLast = _tickNext;
+		_tickNext += _tickPeriod;
+	}
+
+	if(_twiDone <= _hostCycles)
+	{
+		hostTwiComplete();
+	}
+
+	if(_wdtDeadline <= _hostCycles)
+	{
+		_wdtDeadline = _hostCycles + HOST_WDT_TIMEOUT;
+		simOnWatchdogReset(_hostCycles);
+	}
+
+	if(simGetNextEvent() <= _hostCycles)
+	{
+		simRunEvents(_hostCycles);
+	}
+}
+
+/*************************************************************************
+ Get time of the next peripheral or simulator event.
+
+ Return: Virtual time of the next event in CPU clock cycles.
+*************************************************************************/
+UINT64 hostNextEvent()
+{
+	UINT64 next = simGetNextEvent();
+
+	if(_tickNext < next)
+	{
+		next = _tickNext;
+	}
+
+	if(_twiDone < next)
+	{
+		next = _twiDone;
+	}
+
+	if(_eepromIRQ && (_eepromReady < next))
+	{
+		next = _eepromReady;
+	}
+
+	if(_wdtDeadline < next)
+	{
+		next = _wdtDeadline;
+	}
+
+	return next;
+}
+
+/*************************************************************************
+ Service pending interrupts in the priority order of the ATmega8 vector
+ table. Interrupts are serviced only if the global interrupt flag is set.
+
+ Return: TRUE if at least one interrupt is serviced, otherwise FALSE.
+*************************************************************************/
+UCHAR hostDispatch()
+{
+	UCHAR count;
+
+	for(count = 0; (count < HOST_DISPATCH_LIMIT) && (SREG & 0x80); count++)
+	{
+		// Interrupts raised while the previous ISR was running.
+		if(count > 0)
+		{
+			hostUpdate();
+		}
+
+		if(_tickFlag)
+		{
+			_tickFlag = FALSE;
+			hostCallVector(TIMER1_COMPA_vect, HOST_COST_TICK);
+		}
+		else if(_eepromIRQ && (_eepromReady <= _hostCycles))
+		{
+			hostCallVector(EE_RDY_vect, HOST_COST_EEPROM);
+		}
+		else if(_twiInterrupt && _twiEnabled && (_twiControl & (1 << TWIE)))
+		{
+			hostCallVector(TWI_vect, HOST_COST_TWI);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return (count > 0) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Advance virtual time to the next event and service the interrupts.
+
+ Return: TRUE if at least one interrupt is serviced, otherwise FALSE.
+*************************************************************************/
+UCHAR hostStep()
+{
+	UINT64 next = hostNextEvent();
+
+	if(next > _hostCycles)
+	{
+		if(_hostSleeping)
+		{
+			_hostSleepCycles += next - _hostCycles;
+		}
+
+		_hostCycles = next;
+	}
+
+	hostUpdate();
+	return hostDispatch();
+}
+
+/*************************************************************************
+ Enable global interrupts and sleep until an interrupt is serviced (Idle
+ sleep mode). Main loop pass which follows the wake up is charged before
+ returning.
+
+ Return: None
+*************************************************************************/
+VOID hostSleep()
+{
+	sei();
+	hostUpdate();
+
+	if(hostDispatch() == FALSE)
+	{
+		_hostSleeping = TRUE;
+		while(hostStep() == FALSE);
+		_hostSleeping = FALSE;
+	}
+
+	_hostWakeups++;
+	hostCharge(_hostCosts[HOST_COST_MAIN]);
+}
+
+/*************************************************************************
+ Busy wait step. Virtual time advances to the next event.
+
+ Return: None
+*************************************************************************/
+VOID hostWait()
+{
+	hostStep();
+}
+
+/*************************************************************************
+ Busy wait for the specified number of cycles.
+
+ cycles: Number of CPU clock cycles to wait.
+
+ Return: None
+*************************************************************************/
+VOID hostDelay(UINT64 cycles)
+{
+	hostCharge(cycles);
+}
+
+/*************************************************************************
+ Charge CPU cycles of the running code to the virtual time. If global 
+ interrupts are enabled, interrupts which become due are serviced on 
+ time and their run time extends the charged period, as the code is 
+ preempted on the MCU.
+
+ cycles: Number of CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID hostCharge(UINT64 cycles)
+{
+	UINT64 end = _hostCycles + cycles;
+	UINT64 next;
+	UINT64 start;
+
+	while((SREG & 0x80) && ((next = hostNextEvent()) <= end))
+	{
+		if(next > _hostCycles)
+		{
+			_hostCycles = next;
+		}
+
+		start = _hostCycles;
+		hostUpdate();
+		hostDispatch();
+		end += _hostCycles - start;
+	}
+
+	if(end > _hostCycles)
+	{
+		_hostCycles = end;
+	}
+}
+
+/*************************************************************************
+ Get CPU activity counters since the reset. Time spent in the sleep 
+ mode, number of serviced interrupts and number of wake ups from the 
+ sleep mode are reported.
+
+ sleepCycles: Pointer to store the number of CPU clock cycles in sleep.
+
+ interrupts: Pointer to store the number of serviced interrupts.
+
+ wakeups: Pointer to store the number of HAL_SLEEP calls.
+
+ Return: None
+*************************************************************************/
+VOID hostGetActivity(UINT64* sleepCycles, UINT32* interrupts, UINT32* wakeups)
+{
+	*sleepCycles = _hostSleepCycles;
+	*interrupts = _hostInterrupts;
+	*wakeups = _hostWakeups;
+}
+
+/*************************************************************************
+ Get content of the MCUCSR register.
+
+ Return: Reset flags.
+*************************************************************************/
+UCHAR hostGetResetCause()
+{
+	return _hostResetCause;
+}
+
+/*************************************************************************
+ Set content of the MCUCSR register.
+
+ resetCause: Reset flags.
+
+ Return: None
+*************************************************************************/
+VOID hostSetResetCause(UCHAR resetCause)
+{
+	_hostResetCause = resetCause;
+}
+
+/*************************************************************************
+ Start the watchdog timer.
+
+ Return: None
+*************************************************************************/
+VOID hostWatchdogEnable()
+{
+	_wdtEnabled = TRUE;
+	_wdtDeadline = _hostCycles + HOST_WDT_TIMEOUT;
+}
+
+/*************************************************************************
+ Reset the watchdog timer.
+
+ Return: None
+*************************************************************************/
+VOID hostWatchdogReset()
+{
+	if(_wdtEnabled)
+	{
+		_wdtDeadline = _hostCycles + HOST_WDT_TIMEOUT;
+	}
+}
+
+/*************************************************************************
+ Set default state of the ports.
+
+ Return: None
+*************************************************************************/
+VOID hostInitPorts()
+{
+	hostWritePort(HOST_PORTD, 0x00);
+	hostWritePort(HOST_PORTC, 0x00);
+	hostWritePort(HOST_PORTB, 0x07);
+}
+
+/*************************************************************************
+ Write output port. Every write is passed to the port trace.
+
+ port: Port number (HOST_PORTx).
+
+ value: Value to write.
+
+ Return: None
+*************************************************************************/
+VOID hostWritePort(UCHAR port, UCHAR value)
+{
+	_hostPorts[port] = value;
+
+	if(_portTrace)
+	{
+		_portTrace(_hostCycles, port, value);
+	}
+
+	hostCharge(HOST_PORT_CYCLES);
+}
+
+/*************************************************************************
+ Drive the sleep LED output (PB4). Time of the write is recorded, the 
+ main loop of the firmware drives the LED on every pass.
+
+ isOn: Set to TRUE to turn on the LED.
+
+ Return: None
+*************************************************************************/
+VOID hostSetSleepLED(UCHAR isOn)
+{
+	_sleepLedTime = _hostCycles;
+	hostWritePort(HOST_PORTB, isOn ? (_hostPorts[HOST_PORTB] | 0x10) : (_hostPorts[HOST_PORTB] & ~0x10));
+}
+
+/*************************************************************************
+ Get time of the last sleep LED write.
+
+ Return: Virtual time of the write, or HOST_NEVER if the LED is not 
+		 driven since the reset.
+*************************************************************************/
+UINT64 hostGetSleepLEDTime()
+{
+	return _sleepLedTime;
+}
+
+/*************************************************************************
+ Read output port.
+
+ port: Port number (HOST_PORTx).
+
+ Return: Last value written into the port.
+*************************************************************************/
+UCHAR hostReadPort(UCHAR port)
+{
+	return _hostPorts[port];
+}
+
+/*************************************************************************
+ Get state of the push buttons.
+
+ Return: Button mask (1 = pressed).
+*************************************************************************/
+UCHAR hostGetButtons()
+{
+	return _hostButtons;
+}
+
+/*************************************************************************
+ Press or release the push buttons.
+
+ buttons: Button mask (1 = pressed).
+
+ Return: None
+*************************************************************************/
+VOID hostSetButtons(UCHAR buttons)
+{
+	_hostButtons = buttons;
+}
+
+/*************************************************************************
+ Set function to receive all the port writes.
+
+ trace: Trace function or 0 to disable the trace.
+
+ Return: None
+*************************************************************************/
+VOID hostSetPortTrace(VOID (*trace)(UINT64 now, UCHAR port, UCHAR value))
+{
+	_portTrace = trace;
+}
+
+/*************************************************************************
+ Start timer1 in CTC mode with prescaler 8 and enable the compare match
+ interrupt.
+
+ compare: Compare value (OCR1A).
+
+ Return: None
+*************************************************************************/
+VOID hostTickInit(UINT compare)
+{
+	_tickPeriod = ((UINT64)compare + 1) * 8;
+	_tickLast = _hostCycles;
+	_tickNext = _hostCycles + _tickPeriod;
+	_tickFlag = FALSE;
+}
+
+/*************************************************************************
+ Get timer1 count.
+
+ Return: Value of TCNT1.
+*************************************************************************/
+UINT hostTickCount()
+{
+	UINT64 base = _tickLast;
+
+	if(_tickPeriod == 0)
+	{
+		return 0;
+	}
+
+	if(_hostCycles >= _tickNext)
+	{
+		base = _tickNext + (((_hostCycles - _tickNext) / _tickPeriod) * _tickPeriod);
+	}
+
+	return (UINT)((_hostCycles - base) / 8);
+}
+
+/*************************************************************************
+ Check timer1 compare match flag.
+
+ Return: TRUE if compare match is not yet serviced, otherwise FALSE.
+*************************************************************************/
+UCHAR hostTickPending()
+{
+	return (_tickFlag || (_hostCycles >= _tickNext)) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Start timer2 in fast PWM mode with the output disconnected.
+
+ Return: None
+*************************************************************************/
+VOID hostPwmInit()
+{
+	_pwmDuty = 0;
+	_pwmConnected = FALSE;
+}
+
+/*************************************************************************
+ Set PWM duty cycle and connect the PWM output.
+
+ duty: Compare value (OCR2).
+
+ Return: None
+*************************************************************************/
+VOID hostPwmSet(UCHAR duty)
+{
+	_pwmDuty = duty;
+	_pwmConnected = TRUE;
+
+	// PWM output (OC2) replaces PB3, so PORTB is traced again.
+	if(_portTrace)
+	{
+		_portTrace(_hostCycles, HOST_PORTB, _hostPorts[HOST_PORTB]);
+	}
+}
+
+/*************************************************************************
+ Disconnect the PWM output.
+
+ Return: None
+*************************************************************************/
+VOID hostPwmOff()
+{
+	_pwmConnected = FALSE;
+
+	if(_portTrace)
+	{
+		_portTrace(_hostCycles, HOST_PORTB, _hostPorts[HOST_PORTB]);
+	}
+}
+
+/*************************************************************************
+ Get output level of the master light.
+
+ Return: Duty cycle of the master light from 0 (off) to 255.
+*************************************************************************/
+UCHAR hostGetLightOutput()
+{
+	if(_pwmConnected)
+	{
+		return _pwmDuty;
+	}
+
+	return (_hostPorts[HOST_PORTB] & 0x08) ? 0xFF : 0x00;
+}
+
+/*************************************************************************
+ Enable TWI peripheral.
+
+ bitRate: Bit rate register value (TWBR) with prescaler 1.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiInit(UCHAR bitRate)
+{
+	_twiBitRate = bitRate;
+	hostTwiControl(1 << TWEN);
+}
+
+/*************************************************************************
+ Write TWI control register. Writing TWINT clears the interrupt flag and
+ starts the next bus operation.
+
+ control: Value of the TWCR register.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiControl(UCHAR control)
+{
+	UINT64 bitTime = 16 + (2 * (UINT64)_twiBitRate);
+	UINT64 duration = 0;
+
+	_twiControl = control;
+
+	if(!(control & (1 << TWEN)))
+	{
+		_twiEnabled = FALSE;
+		_twiOperation = TWI_OP_NONE;
+		_twiDone = HOST_NEVER;
+		return;
+	}
+
+	_twiEnabled = TRUE;
+
+	if(!(control & (1 << TWINT)))
+	{
+		return;
+	}
+
+	_twiInterrupt = FALSE;
+	_twiOperation = TWI_OP_NONE;
+
+	if(control & (1 << TWSTO))
+	{
+		hostTwiStop();
+		_twiStatus = TW_NO_INFO;
+		duration = bitTime;
+	}
+
+	if(control & (1 << TWSTA))
+	{
+		_twiOperation = TWI_OP_START;
+		duration += bitTime;
+	}
+	else if(!(control & (1 << TWSTO)))
+	{
+		switch(_twiStatus)
+		{
+			case TW_START:
+			case TW_REP_START:
+				_twiOperation = TWI_OP_ADDRESS;
+				break;
+			case TW_MT_SLA_ACK:
+			case TW_MT_DATA_ACK:
+				_twiOperation = TWI_OP_WRITE;
+				break;
+			case TW_MR_SLA_ACK:
+			case TW_MR_DATA_ACK:
+				_twiOperation = TWI_OP_READ;
+				break;
+		}
+
+		duration = 9 * bitTime;
+
+		// Slave stretches the clock on data bytes.
+		if(_twiActive && ((_twiOperation == TWI_OP_WRITE) || (_twiOperation == TWI_OP_READ)))
+		{
+			duration += _twiActive->delay;
+		}
+	}
+
+	// Start condition is not generated while SDA is held low by a device. 
+	// TWINT is never set and the transfer has to be aborted by the master.
+	if((_twiOperation == TWI_OP_NONE) || ((_twiOperation == TWI_OP_START) && !hostTwiBusSDA()))
+	{
+		_twiDone = HOST_NEVER;
+	}
+	else
+	{
+		_twiDone = _hostCycles + duration;
+		_twiBusyCycles += duration;
+	}
+}
+
+/*************************************************************************
+ Get TWI status.
+
+ Return: Status code (TW_STATUS).
+*************************************************************************/
+UCHAR hostTwiStatus()
+{
+	return _twiStatus;
+}
+
+/*************************************************************************
+ Write TWI data register.
+
+ data: Address or data byte to transmit.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiWrite(UCHAR data)
+{
+	_twiData = data;
+}
+
+/*************************************************************************
+ Read TWI data register.
+
+ Return: Last received byte.
+*************************************************************************/
+UCHAR hostTwiRead()
+{
+	return _twiData;
+}
+
+/*************************************************************************
+ Set state of the manually driven TWI pins.
+
+ sda: TRUE to release SDA, FALSE to drive it low.
+
+ scl: TRUE to release SCL, FALSE to drive it low.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiSetPins(UCHAR sda, UCHAR scl)
+{
+	_twiSDA = sda;
+	_twiSCL = scl;
+}
+
+/*************************************************************************
+ Drive SDA pin. Rising SDA while SCL is high is a stop condition.
+
+ isHigh: TRUE to release the line, FALSE to drive it low.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiSetSDA(UCHAR isHigh)
+{
+	if(isHigh && !_twiSDA && _twiSCL)
+	{
+		hostTwiStop();
+	}
+
+	_twiSDA = isHigh;
+}
+
+/*************************************************************************
+ Drive SCL pin. Devices are clocked on the rising edge.
+
+ isHigh: TRUE to release the line, FALSE to drive it low.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiSetSCL(UCHAR isHigh)
+{
+	UCHAR deviceId;
+
+	if(isHigh && !_twiSCL)
+	{
+		for(deviceId = 0; deviceId < _twiDeviceCount; deviceId++)
+		{
+			if(_twiDevices[deviceId]->clock)
+			{
+				_twiDevices[deviceId]->clock(_twiDevices[deviceId]->context);
+			}
+		}
+	}
+
+	_twiSCL = isHigh;
+}
+
+/*************************************************************************
+ Read SDA line.
+
+ Return: TRUE if the line is high, otherwise FALSE.
+*************************************************************************/
+UCHAR hostTwiGetSDA()
+{
+	return hostTwiBusSDA();
+}
+
+/*************************************************************************
+ Get total time of the TWI bus operations since the reset.
+
+ Return: Number of CPU clock cycles the TWI bus was active.
+*************************************************************************/
+UINT64 hostTwiBusyCycles()
+{
+	return _twiBusyCycles;
+}
+
+/*************************************************************************
+ Attach I2C slave device to the virtual TWI bus.
+
+ device: Device to attach. Device must stay valid during the simulation.
+
+ Return: None
+*************************************************************************/
+VOID hostTwiAttach(PHOST_TWI_DEVICE device)
+{
+	if(_twiDeviceCount < HOST_TWI_DEVICES)
+	{
+		_twiDevices[_twiDeviceCount++] = device;
+	}
+}
+
+/*************************************************************************
+ Read single byte from the EEPROM.
+
+ address: EEPROM address.
+
+ Return: Content of the EEPROM.
+*************************************************************************/
+UCHAR hostEepromReadByte(UINT address)
+{
+	return _eeprom[address % HAL_EEPROM_SIZE];
+}
+
+/*************************************************************************
+ Read block of data from the EEPROM.
+
+ buffer: Buffer to fill.
+
+ address: Start address of the EEPROM block.
+
+ length: Number of bytes to read.
+
+ Return: None
+*************************************************************************/
+VOID hostEepromReadBlock(PUCHAR buffer, UINT address, UINT length)
+{
+	while(length--)
+	{
+		*buffer++ = hostEepromReadByte(address++);
+	}
+}
+
+/*************************************************************************
+ Set EEPROM address register and read the content.
+
+ address: EEPROM address (EEAR).
+
+ Return: Content of the EEPROM (EEDR).
+*************************************************************************/
+UCHAR hostEepromGet(UINT address)
+{
+	_eepromAddress = address % HAL_EEPROM_SIZE;
+	return _eeprom[_eepromAddress];
+}
+
+/*************************************************************************
+ Start EEPROM write at the address set by hostEepromGet. EEPROM stays
+ busy for HOST_EEPROM_WRITE_TIME.
+
+ data: Byte to write (EEDR).
+
+ Return: None
+*************************************************************************/
+VOID hostEepromPut(UCHAR data)
+{
+	_eeprom[_eepromAddress] = data;
+	_eepromReady = _hostCycles + HOST_EEPROM_WRITE_TIME;
+	_eepromWrites++;
+}
+
+/*************************************************************************
+ Enable or disable EEPROM ready interrupt.
+
+ isEnabled: TRUE to enable the interrupt.
+
+ Return: None
+*************************************************************************/
+VOID hostEepromSetIRQ(UCHAR isEnabled)
+{
+	_eepromIRQ = isEnabled;
+}
+
+/*************************************************************************
+ Get state of the EEPROM ready interrupt.
+
+ Return: TRUE if interrupt is enabled, otherwise FALSE.
+*************************************************************************/
+UCHAR hostEepromGetIRQ()
+{
+	return _eepromIRQ;
+}
+
+/*************************************************************************
+ Get EEPROM content to preload or inspect.
+
+ Return: EEPROM content (HAL_EEPROM_SIZE bytes).
+*************************************************************************/
+PUCHAR hostEepromData()
+{
+	if(_eepromErased == FALSE)
+	{
+		memset(_eeprom, 0xFF, sizeof(_eeprom));
+		_eepromErased = TRUE;
+	}
+
+	return _eeprom;
+}
+
+/*************************************************************************
+ Get number of EEPROM byte writes since the reset.
+
+ Return: Number of writes.
+*************************************************************************/
+UINT32 hostEepromWriteCount()
+{
+	return _eepromWrites;
+}
+
+/*************************************************************************
+ CRC-CCITT update (same as _crc_ccitt_update of avr-libc).
+
+ crc: Current CRC value.
+
+ data: Next data byte.
+
+ Return: Updated CRC value.
+*************************************************************************/
+UINT _crc_ccitt_update(UINT crc, UCHAR data)
+{
+	data ^= (UCHAR)(crc & 0xFF);
+	data ^= (UCHAR)(data << 4);
+
+	return (UINT)((((UINT)data << 8) | (crc >> 8)) ^ (UCHAR)(data >> 4) ^ ((UINT)data << 3));
+}
+
+/*************************************************************************
+ Dallas iButton CRC-8 update (same as _crc_ibutton_update of avr-libc).
+
+ crc: Current CRC value.
+
+ data: Next data byte.
+
+ Return: Updated CRC value.
+*************************************************************************/
+UCHAR _crc_ibutton_update(UCHAR crc, UCHAR data)
+{
+	UCHAR bit;
+
+	crc ^= data;
+	for(bit = 0; bit < 8; bit++)
+	{
+		crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+	}
+
+	return crc;
+}
@@ -0,0 +1,240 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     halhost.h
+* Info:		Linux host backend of the hardware abstraction layer.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#ifndef HAL_HOST_HEADER
+#define HAL_HOST_HEADER
+
+#define UINT64	unsigned long long
+
+// Virtual CPU clock. Simulator time is counted in CPU clock cycles.
+#define HOST_US_TO_CYCLES(us)	((UINT64)(us) * (F_CPU / 1000000UL))
+#define HOST_MS_TO_CYCLES(ms)	((UINT64)(ms) * (F_CPU / 1000UL))
+#define HOST_CYCLES_TO_MS(c)	((c) / (F_CPU / 1000UL))
+#define HOST_NEVER				0xFFFFFFFFFFFFFFFFULL
+
+// Watchdog timeout (WDTO_2S) and EEPROM write time of the ATmega8.
+#define HOST_WDT_TIMEOUT		HOST_MS_TO_CYCLES(2100)
+#define HOST_EEPROM_WRITE_TIME	HOST_US_TO_CYCLES(8500)
+
+// Firmware code runs in zero virtual time, so the interrupt service 
+// routines and the main loop pass after each wake up are charged with 
+// their CPU cycle counts. Costs are the averages measured by the simavr 
+// benchmark (bench/build/cycles.txt, loaded with lightsim -c). Built-in 
+// defaults are estimates used until the measured counts are loaded.
+#define HOST_COST_TICK			0
+#define HOST_COST_EEPROM		1
+#define HOST_COST_TWI			2
+#define HOST_COST_MAIN			3
+#define HOST_COST_COUNT			4
+
+// Interrupt response, vector jump and ISR prologue before the first port
+// access, and the cost of a port write (IN, ORI / ANDI, OUT). Port writes
+// of an ISR are spread over its run time by these costs.
+#define HOST_ISR_ENTRY_CYCLES	30
+#define HOST_PORT_CYCLES		3
+
+// Status register. Only the global interrupt flag is modelled.
+extern UCHAR SREG;
+
+#define cli()					(SREG &= 0x7F)
+#define sei()					(SREG |= 0x80)
+
+// Interrupt vectors are plain functions, called by the simulator.
+#define ISR(vector)				VOID vector(VOID)
+
+VOID TIMER1_COMPA_vect(VOID);
+VOID EE_RDY_vect(VOID);
+VOID TWI_vect(VOID);
+
+// Program memory is ordinary memory on the host.
+#define PROGMEM
+#define pgm_read_byte(p)		(*(const UCHAR*)(p))
+
+// MCUCSR flags.
+#define PORF	0
+#define EXTRF	1
+#define BORF	2
+#define WDRF	3
+
+// TWCR flags.
+#define TWIE	0
+#define TWEN	2
+#define TWWC	3
+#define TWSTO	4
+#define TWSTA	5
+#define TWEA	6
+#define TWINT	7
+
+// TWI status codes (compat/twi.h).
+#define TW_START			0x08
+#define TW_REP_START		0x10
+#define TW_MT_SLA_ACK		0x18
+#define TW_MT_SLA_NACK		0x20
+#define TW_MT_DATA_ACK		0x28
+#define TW_MT_DATA_NACK		0x30
+#define TW_MT_ARB_LOST		0x38
+#define TW_MR_SLA_ACK		0x40
+#define TW_MR_SLA_NACK		0x48
+#define TW_MR_DATA_ACK		0x50
+#define TW_MR_DATA_NACK		0x58
+#define TW_NO_INFO			0xF8
+#define TW_BUS_ERROR		0x00
+#define TW_READ				1
+#define TW_WRITE			0
+
+// Port numbers used by the port write trace.
+#define HOST_PORTB		0
+#define HOST_PORTC		1
+#define HOST_PORTD		2
+#define HOST_PORT_COUNT	3
+
+// System control.
+#define HAL_SLEEP()					hostSleep()
+#define HAL_WAIT()					hostWait()
+#define HAL_DELAY_US(us)			hostDelay(HOST_US_TO_CYCLES(us))
+#define HAL_RESET_CAUSE()			hostGetResetCause()
+#define HAL_CLEAR_RESET_CAUSE()		hostSetResetCause(0x00)
+#define HAL_WDT_ENABLE()			hostWatchdogEnable()
+#define HAL_WDT_RESET()				hostWatchdogReset()
+#define HAL_STARTUP_TIME			0
+
+// Ports.
+#define HAL_INIT_PORTS()			hostInitPorts()
+#define HAL_DISPLAY_BLANK()			hostWritePort(HOST_PORTC, hostReadPort(HOST_PORTC) & 0xF0)
+#define HAL_DISPLAY_SEGMENTS(s)		hostWritePort(HOST_PORTD, (s))
+#define HAL_DISPLAY_DIGIT(d)		hostWritePort(HOST_PORTC, hostReadPort(HOST_PORTC) | (1 << (d)))
+#define HAL_BUTTON_STATE()			hostGetButtons()
+#define HAL_LIGHT_ON()				hostWritePort(HOST_PORTB, hostReadPort(HOST_PORTB) | 0x08)
+#define HAL_LIGHT_OFF()				hostWritePort(HOST_PORTB, hostReadPort(HOST_PORTB) & ~0x08)
+#define HAL_SLEEP_LED_ON()			hostSetSleepLED(TRUE)
+#define HAL_SLEEP_LED_OFF()			hostSetSleepLED(FALSE)
+
+// Timers.
+#define HAL_TICK_INIT(compare)		hostTickInit(compare)
+#define HAL_TICK_COUNT()			hostTickCount()
+#define HAL_TICK_PENDING()			hostTickPending()
+#define HAL_PWM_INIT()				hostPwmInit()
+#define HAL_PWM_SET(duty)			hostPwmSet(duty)
+#define HAL_PWM_OFF()				hostPwmOff()
+#define HAL_PROFILE_TIMER_INIT()
+#define HAL_PROFILE_TIMER_COUNT()	((UCHAR)(hostGetCycles() / 8))
+
+// TWI.
+#define HAL_TWI_INIT(bitRate)		hostTwiInit(bitRate)
+#define HAL_TWI_CONTROL(c)			hostTwiControl(c)
+#define HAL_TWI_IS_STOPPING()		FALSE
+#define HAL_TWI_STATUS()			hostTwiStatus()
+#define HAL_TWI_WRITE(d)			hostTwiWrite(d)
+#define HAL_TWI_READ()				hostTwiRead()
+#define HAL_TWI_RELEASE_PINS()		hostTwiSetPins(TRUE, TRUE)
+#define HAL_TWI_SDA_LOW()			hostTwiSetSDA(FALSE)
+#define HAL_TWI_SDA_RELEASE()		hostTwiSetSDA(TRUE)
+#define HAL_TWI_SCL_LOW()			hostTwiSetSCL(FALSE)
+#define HAL_TWI_SCL_RELEASE()		hostTwiSetSCL(TRUE)
+#define HAL_TWI_SDA_STATE()			hostTwiGetSDA()
+
+// EEPROM.
+#define HAL_EEPROM_SIZE				512
+#define HAL_EEPROM_READ_BYTE(a)		hostEepromReadByte((UINT)(unsigned long)(a))
+#define HAL_EEPROM_READ_BLOCK(b, a, n)	hostEepromReadBlock((PUCHAR)(b), (UINT)(unsigned long)(a), (n))
+#define HAL_EEPROM_GET(a)			hostEepromGet(a)
+#define HAL_EEPROM_PUT(d)			hostEepromPut(d)
+#define HAL_EEPROM_IRQ_ENABLE()		hostEepromSetIRQ(TRUE)
+#define HAL_EEPROM_IRQ_DISABLE()	hostEepromSetIRQ(FALSE)
+#define HAL_EEPROM_IRQ_ACTIVE()		hostEepromGetIRQ()
+
+// I2C slave device attached to the virtual TWI bus. Addresses are in the
+// 8-bit (write address) format. start returns TRUE to acknowledge the
+// address, write returns TRUE to acknowledge the data byte and read
+// returns the next byte (ack is FALSE on the last byte of the transfer).
+// Optional sda returns FALSE while the device holds SDA low, and optional
+// clock is called on each SCL rising edge driven by the pins. Each data
+// byte is stretched by delay CPU clock cycles.
+struct hostTwiDeviceStruct
+{
+	UCHAR address;
+	VOID* context;
+	UCHAR (*start)(VOID* context, UCHAR isRead);
+	UCHAR (*write)(VOID* context, UCHAR data);
+	UCHAR (*read)(VOID* context, UCHAR ack);
+	VOID (*stop)(VOID* context);
+	UCHAR (*sda)(VOID* context);
+	VOID (*clock)(VOID* context);
+	UINT64 delay;
+};
+
+#define HOST_TWI_DEVICE		struct hostTwiDeviceStruct
+#define PHOST_TWI_DEVICE	HOST_TWI_DEVICE*
+
+// Maximum number of devices on the virtual TWI bus.
+#define HOST_TWI_DEVICES	4
+
+// Simulator hooks. The simulator provides the time of its next scheduled
+// event and handles the event when the virtual time reaches it.
+UINT64 simGetNextEvent();
+VOID simRunEvents(UINT64 now);
+VOID simOnWatchdogReset(UINT64 now);
+
+VOID hostReset(UCHAR resetCause);
+UINT64 hostGetCycles();
+VOID hostSleep();
+VOID hostWait();
+VOID hostDelay(UINT64 cycles);
+VOID hostCharge(UINT64 cycles);
+UCHAR hostLoadCosts(const char* fileName);
+VOID hostGetActivity(UINT64* sleepCycles, UINT32* interrupts, UINT32* wakeups);
+UCHAR hostGetResetCause();
+VOID hostSetResetCause(UCHAR resetCause);
+VOID hostWatchdogEnable();
+VOID hostWatchdogReset();
+
+VOID hostInitPorts();
+VOID hostWritePort(UCHAR port, UCHAR value);
+UCHAR hostReadPort(UCHAR port);
+UCHAR hostGetButtons();
+VOID hostSetButtons(UCHAR buttons);
+VOID hostSetPortTrace(VOID (*trace)(UINT64 now, UCHAR port, UCHAR value));
+VOID hostSetSleepLED(UCHAR isOn);
+UINT64 hostGetSleepLEDTime();
+
+VOID hostTickInit(UINT compare);
+UINT hostTickCount();
+UCHAR hostTickPending();
+VOID hostPwmInit();
+VOID hostPwmSet(UCHAR duty);
+VOID hostPwmOff();
+UCHAR hostGetLightOutput();
+
+VOID hostTwiInit(UCHAR bitRate);
+VOID hostTwiControl(UCHAR control);
+UCHAR hostTwiStatus();
+VOID hostTwiWrite(UCHAR data);
+UCHAR hostTwiRead();
+VOID hostTwiSetPins(UCHAR sda, UCHAR scl);
+VOID hostTwiSetSDA(UCHAR isHigh);
+VOID hostTwiSetSCL(UCHAR isHigh);
+UCHAR hostTwiGetSDA();
+UINT64 hostTwiBusyCycles();
+VOID hostTwiAttach(PHOST_TWI_DEVICE device);
+
+UCHAR hostEepromReadByte(UINT address);
+VOID hostEepromReadBlock(PUCHAR buffer, UINT address, UINT length);
+UCHAR hostEepromGet(UINT address);
+VOID hostEepromPut(UCHAR data);
+VOID hostEepromSetIRQ(UCHAR isEnabled);
+UCHAR hostEepromGetIRQ();
+PUCHAR hostEepromData();
+UINT32 hostEepromWriteCount();
+
+UINT _crc_ccitt_update(UINT crc, UCHAR data);
+UCHAR _crc_ibutton_update(UCHAR crc, UCHAR data);
+
+#endif
@@ -0,0 +1,34 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     hoststack.c
+* Info:		Host replacement of the stack monitor. RAM layout of the
+*			ATmega8 does not exist on the host.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "stackmodule.h"
+
+/*************************************************************************
+ Get size of the statically allocated RAM.
+ 
+ Return: Always 0 on the host.
+*************************************************************************/
+UINT getStaticRAMSize()
+{
+	return 0;
+}
+
+/*************************************************************************
+ Get lowest amount of free RAM observed since the reset.
+ 
+ Return: Always 0 on the host.
+*************************************************************************/
+UINT getFreeRAM()
+{
+	return 0;
+}
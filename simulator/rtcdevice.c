@@ -0,0 +1,533 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     rtcdevice.c
+* Info:		DS1307 RTC model attached to the virtual TWI bus. Time keeper
+*			registers are updated from a virtual 32.768 kHz oscillator,
+*			and bus and battery faults can be injected by the simulator.
+*			Reference time is the wall time kept by the same oscillator,
+*			which never stops.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "halmodule.h"
+#include "rtcdevice.h"
+
+#include <string.h>
+
+// Implemented bits of the time keeper registers (unused bits read as 0).
+const UCHAR _rtcRegisterMask[RTC_RAM_START] = {0xFF, 0x7F, 0x7F, 0x07, 0x3F, 0x1F, 0xFF, RTC_CONTROL_MASK};
+
+UCHAR rtcStart(VOID* context, UCHAR isRead);
+UCHAR rtcWrite(VOID* context, UCHAR data);
+UCHAR rtcRead(VOID* context, UCHAR ack);
+VOID rtcStop(VOID* context);
+UCHAR rtcGetSDA(VOID* context);
+VOID rtcClock(VOID* context);
+
+/*************************************************************************
+ Convert binary coded decimal value to decimal.
+ 
+ inVal: BCD value.
+ 
+ Return: Decimal value.
+*************************************************************************/
+UCHAR rtcFromBcd(UCHAR inVal)
+{
+	return ((inVal >> 4) * 10) + (inVal & 0x0F);
+}
+
+/*************************************************************************
+ Convert decimal value to binary coded decimal.
+ 
+ inVal: Decimal value (0 - 99).
+ 
+ Return: BCD value.
+*************************************************************************/
+UCHAR rtcToBcd(UCHAR inVal)
+{
+	return ((inVal / 10) << 4) | (inVal % 10);
+}
+
+/*************************************************************************
+ Increment BCD register and wrap around at the specified limit.
+ 
+ reg: Register to increment.
+ 
+ mask: Mask of the valid bits of the register.
+ 
+ first: First value of the register (after wrap around).
+ 
+ limit: Last value of the register.
+ 
+ Return: TRUE if register is wrapped around, otherwise FALSE.
+*************************************************************************/
+UCHAR rtcIncrement(PUCHAR reg, UCHAR mask, UCHAR first, UCHAR limit)
+{
+	UCHAR value = rtcFromBcd(*reg & mask) + 1;
+	UCHAR isWrapped = (value > limit) ? TRUE : FALSE;
+	
+	if(isWrapped)
+	{
+		value = first;
+	}
+	
+	*reg = (*reg & ~mask) | rtcToBcd(value);
+	return isWrapped;
+}
+
+/*************************************************************************
+ Get number of days in the current month of the RTC.
+ 
+ rtc: RTC device.
+ 
+ Return: Number of days in the month.
+*************************************************************************/
+UCHAR rtcDaysInMonth(PRTC_DEVICE rtc)
+{
+	UCHAR month = rtcFromBcd(rtc->registers[RTC_REG_MONTH] & 0x1F);
+	UCHAR year = rtcFromBcd(rtc->registers[RTC_REG_YEAR]);
+	
+	if(month == 2)
+	{
+		return (year % 4) ? 28 : 29;
+	}
+	
+	return ((month == 4) || (month == 6) || (month == 9) || (month == 11)) ? 30 : 31;
+}
+
+/*************************************************************************
+ Check BCD value.
+ 
+ inVal: BCD value.
+ 
+ limit: Largest valid decimal value.
+ 
+ Return: TRUE if both digits are valid and the value is within the limit.
+*************************************************************************/
+UCHAR rtcIsValidBcd(UCHAR inVal, UCHAR limit)
+{
+	return (((inVal & 0x0F) < 10) && ((inVal >> 4) < 10) && (rtcFromBcd(inVal) <= limit)) ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Advance hours register by one hour in 12 or 24 hour mode.
+ 
+ reg: Hours register.
+ 
+ Return: TRUE on day roll over, otherwise FALSE.
+*************************************************************************/
+UCHAR rtcIncrementHours(PUCHAR reg)
+{
+	UCHAR hours;
+	
+	if(!(*reg & RTC_12H_BIT))
+	{
+		return rtcIncrement(reg, 0x3F, 0, 23);
+	}
+	
+	// 12 hour mode: 11 -> 12 toggles AM / PM, 12 -> 1 keeps it.
+	hours = rtcFromBcd(*reg & 0x1F) + 1;
+	if(hours == 12)
+	{
+		*reg ^= RTC_PM_BIT;
+		*reg = (*reg & 0xE0) | rtcToBcd(hours);
+		return (*reg & RTC_PM_BIT) ? FALSE : TRUE;
+	}
+	
+	*reg = (*reg & 0xE0) | rtcToBcd((hours > 12) ? 1 : hours);
+	return FALSE;
+}
+
+/*************************************************************************
+ Get next pseudo random number of the device.
+ 
+ rtc: RTC device.
+ 
+ Return: Random byte.
+*************************************************************************/
+UCHAR rtcRandom(PRTC_DEVICE rtc)
+{
+	rtc->seed = (rtc->seed * 1103515245UL) + 12345UL;
+	return (UCHAR)(rtc->seed >> 16);
+}
+
+/*************************************************************************
+ Advance time keeper registers by one second.
+ 
+ rtc: RTC device.
+ 
+ Return: None
+*************************************************************************/
+VOID rtcAddSecond(PRTC_DEVICE rtc)
+{
+	PUCHAR reg = rtc->registers;
+	
+	if(!rtcIncrement(&reg[RTC_REG_SECONDS], 0x7F, 0, 59))
+	{
+		return;
+	}
+	
+	if(!rtcIncrement(&reg[RTC_REG_MINUTES], 0x7F, 0, 59))
+	{
+		return;
+	}
+	
+	if(!rtcIncrementHours(&reg[RTC_REG_HOURS]))
+	{
+		return;
+	}
+	
+	rtcIncrement(&reg[RTC_REG_DAY], 0x07, 1, 7);
+	
+	if(!rtcIncrement(&reg[RTC_REG_DATE], 0x3F, 1, rtcDaysInMonth(rtc)))
+	{
+		return;
+	}
+	
+	if(!rtcIncrement(&reg[RTC_REG_MONTH], 0x1F, 1, 12))
+	{
+		return;
+	}
+	
+	rtcIncrement(&reg[RTC_REG_YEAR], 0xFF, 0, 99);
+}
+
+/*************************************************************************
+ Initialize RTC device and attach it to the virtual TWI bus. RAM content 
+ is cleared, the calendar is set to 01/01/2000 and the oscillator runs 
+ at the nominal frequency.
+ 
+ rtc: RTC device.
+ 
+ startTime: Initial time of the RTC (24 hour format).
+ 
+ is12Hour: Set to TRUE to run the RTC in 12 hour mode.
+ 
+ Return: None
+*************************************************************************/
+VOID initRTCDevice(PRTC_DEVICE rtc, PTIME startTime, UCHAR is12Hour)
+{
+	UCHAR hours = startTime->hours;
+	
+	memset(rtc, 0, sizeof(RTC_DEVICE));
+	
+	rtc->registers[RTC_REG_SECONDS] = rtcToBcd(startTime->seconds);
+	rtc->registers[RTC_REG_MINUTES] = rtcToBcd(startTime->minutes);
+	rtc->registers[RTC_REG_HOURS] = rtcToBcd(hours);
+	rtc->registers[RTC_REG_DAY] = 0x01;
+	rtc->registers[RTC_REG_DATE] = 0x01;
+	rtc->registers[RTC_REG_MONTH] = 0x01;
+	
+	if(is12Hour)
+	{
+		rtc->registers[RTC_REG_HOURS] = RTC_12H_BIT | ((hours >= 12) ? RTC_PM_BIT : 0) | 
+			rtcToBcd(((hours % 12) == 0) ? 12 : (hours % 12));
+	}
+	
+	rtc->lastUpdate = hostGetCycles();
+	rtc->cyclesPerSecond = (UINT64)F_CPU;
+	rtc->seed = 0x1307;
+	
+	rtc->referenceTime = ((UINT32)hours * 3600UL) + ((UINT32)startTime->minutes * 60UL) + startTime->seconds;
+	rtc->isReferenceValid = TRUE;
+	
+	rtc->bus.address = RTC_DEVICE_ADDRESS;
+	rtc->bus.context = rtc;
+	rtc->bus.start = rtcStart;
+	rtc->bus.write = rtcWrite;
+	rtc->bus.read = rtcRead;
+	rtc->bus.stop = rtcStop;
+	rtc->bus.sda = rtcGetSDA;
+	rtc->bus.clock = rtcClock;
+	
+	hostTwiAttach(&rtc->bus);
+}
+
+/*************************************************************************
+ Update time keeper registers and the reference time up to the current 
+ virtual time. Oscillator of the time keeper registers is stopped while 
+ the CH bit is set, reference time keeps running.
+ 
+ rtc: RTC device.
+ 
+ Return: None
+*************************************************************************/
+VOID updateRTCDevice(PRTC_DEVICE rtc)
+{
+	UINT64 now = hostGetCycles();
+	
+	rtc->referenceDivider += now - rtc->lastUpdate;
+	
+	while(rtc->referenceDivider >= rtc->cyclesPerSecond)
+	{
+		rtc->referenceDivider -= rtc->cyclesPerSecond;
+		rtc->referenceTime = (rtc->referenceTime + 1) % RTC_DAY_SECONDS;
+	}
+	
+	if(!(rtc->registers[RTC_REG_SECONDS] & RTC_CH_BIT))
+	{
+		rtc->divider += now - rtc->lastUpdate;
+		
+		while(rtc->divider >= rtc->cyclesPerSecond)
+		{
+			rtc->divider -= rtc->cyclesPerSecond;
+			rtcAddSecond(rtc);
+		}
+	}
+	
+	rtc->lastUpdate = now;
+}
+
+/*************************************************************************
+ Get current time of the RTC device in 24 hour format.
+ 
+ rtc: RTC device.
+ 
+ timeInfo: Pointer to store the time.
+ 
+ Return: TRUE if time keeper registers hold a valid time, otherwise FALSE.
+*************************************************************************/
+UCHAR getRTCDeviceTime(PRTC_DEVICE rtc, PTIME timeInfo)
+{
+	UCHAR hours;
+	UCHAR isValid;
+	
+	updateRTCDevice(rtc);
+	
+	hours = rtc->registers[RTC_REG_HOURS];
+	timeInfo->seconds = rtcFromBcd(rtc->registers[RTC_REG_SECONDS] & 0x7F);
+	timeInfo->minutes = rtcFromBcd(rtc->registers[RTC_REG_MINUTES] & 0x7F);
+	
+	isValid = rtcIsValidBcd(rtc->registers[RTC_REG_SECONDS] & 0x7F, 59) && 
+		rtcIsValidBcd(rtc->registers[RTC_REG_MINUTES] & 0x7F, 59);
+	
+	if(hours & RTC_12H_BIT)
+	{
+		timeInfo->hours = (rtcFromBcd(hours & 0x1F) % 12) + ((hours & RTC_PM_BIT) ? 12 : 0);
+		isValid = isValid && rtcIsValidBcd(hours & 0x1F, 12) && ((hours & 0x1F) != 0);
+	}
+	else
+	{
+		timeInfo->hours = rtcFromBcd(hours & 0x3F);
+		isValid = isValid && rtcIsValidBcd(hours & 0x3F, 23);
+	}
+	
+	return isValid ? TRUE : FALSE;
+}
+
+/*************************************************************************
+ Get current reference time (wall time) in 24 hour format. Reference is 
+ lost on the battery fault and restarts from the first time written 
+ into the time keeper registers after it.
+ 
+ rtc: RTC device.
+ 
+ timeInfo: Pointer to store the time.
+ 
+ Return: TRUE if reference time is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR getRTCDeviceReference(PRTC_DEVICE rtc, PTIME timeInfo)
+{
+	updateRTCDevice(rtc);
+	
+	timeInfo->hours = rtc->referenceTime / 3600;
+	timeInfo->minutes = (rtc->referenceTime / 60) % 60;
+	timeInfo->seconds = rtc->referenceTime % 60;
+	
+	return rtc->isReferenceValid;
+}
+
+/*************************************************************************
+ Inject fault into the RTC device.
+ 
+ rtc: RTC device.
+ 
+ faultId: Fault to inject (RTC_FAULT_xxx).
+ 
+ value: RTC_FAULT_NACK - TRUE to NACK all the transfers, FALSE to stop.
+		RTC_FAULT_DELAY - Clock stretching per data byte in microseconds.
+		RTC_FAULT_DRIFT - Oscillator frequency error in ppm.
+		Ignored for the other faults.
+ 
+ Return: None
+*************************************************************************/
+VOID setRTCDeviceFault(PRTC_DEVICE rtc, UCHAR faultId, INT32 value)
+{
+	UCHAR regId;
+	
+	updateRTCDevice(rtc);
+	
+	switch(faultId)
+	{
+		case RTC_FAULT_NACK:
+			rtc->isNack = value ? TRUE : FALSE;
+			break;
+		case RTC_FAULT_STUCK_SDA:
+			// Device holds SDA low as if the master was reset in the middle 
+			// of a read transfer.
+			rtc->stuckClocks = RTC_STUCK_CLOCKS;
+			break;
+		case RTC_FAULT_BATTERY:
+			// Main supply and backup battery lost. Registers and RAM power up 
+			// with random content. Minutes hold an invalid BCD digit and the 
+			// hours are out of range in both 12 and 24 hour modes.
+			for(regId = 0; regId < RTC_REG_COUNT; regId++)
+			{
+				rtc->registers[regId] = rtcRandom(rtc) & ((regId < RTC_RAM_START) ? _rtcRegisterMask[regId] : 0xFF);
+			}
+			
+			rtc->registers[RTC_REG_MINUTES] |= 0x0A;
+			rtc->registers[RTC_REG_HOURS] |= 0x1A;
+			rtc->divider = 0;
+			rtc->isReferenceValid = FALSE;
+			rtc->isTimeWritten = FALSE;
+			break;
+		case RTC_FAULT_HALT:
+			rtc->registers[RTC_REG_SECONDS] |= RTC_CH_BIT;
+			break;
+		case RTC_FAULT_DELAY:
+			rtc->bus.delay = HOST_US_TO_CYCLES(value);
+			break;
+		case RTC_FAULT_DRIFT:
+			rtc->cyclesPerSecond = ((UINT64)F_CPU * 1000000ULL) / (UINT64)(1000000L + value);
+			break;
+	}
+}
+
+/*************************************************************************
+ Start condition followed by the device address. Time keeper registers 
+ are updated at the start of each transfer. Address is not acknowledged
+ while the NACK or stuck SDA fault is active.
+ 
+ context: RTC device.
+ 
+ isRead: TRUE for read transfers.
+ 
+ Return: TRUE to acknowledge the address.
+*************************************************************************/
+UCHAR rtcStart(VOID* context, UCHAR isRead)
+{
+	PRTC_DEVICE rtc = (PRTC_DEVICE)context;
+	
+	if(rtc->isNack || rtc->stuckClocks)
+	{
+		return FALSE;
+	}
+	
+	updateRTCDevice(rtc);
+	rtc->isPointerSet = isRead;
+	return TRUE;
+}
+
+/*************************************************************************
+ Receive data byte. First byte of the write transfer sets the register 
+ pointer. Writing the seconds register resets the oscillator divider.
+ 
+ context: RTC device.
+ 
+ data: Received byte.
+ 
+ Return: TRUE to acknowledge the byte.
+*************************************************************************/
+UCHAR rtcWrite(VOID* context, UCHAR data)
+{
+	PRTC_DEVICE rtc = (PRTC_DEVICE)context;
+	
+	if(rtc->isPointerSet == FALSE)
+	{
+		rtc->pointer = data % RTC_REG_COUNT;
+		rtc->isPointerSet = TRUE;
+		return TRUE;
+	}
+	
+	if(rtc->pointer == RTC_REG_SECONDS)
+	{
+		rtc->divider = 0;
+		rtc->isTimeWritten = TRUE;
+	}
+	
+	if(rtc->pointer < RTC_RAM_START)
+	{
+		data &= _rtcRegisterMask[rtc->pointer];
+	}
+	
+	rtc->registers[rtc->pointer] = data;
+	rtc->pointer = (rtc->pointer + 1) % RTC_REG_COUNT;
+	return TRUE;
+}
+
+/*************************************************************************
+ Transmit data byte from the register pointer.
+ 
+ context: RTC device.
+ 
+ ack: FALSE on the last byte of the transfer.
+ 
+ Return: Register content.
+*************************************************************************/
+UCHAR rtcRead(VOID* context, UCHAR ack)
+{
+	PRTC_DEVICE rtc = (PRTC_DEVICE)context;
+	UCHAR data = rtc->registers[rtc->pointer];
+	
+	rtc->pointer = (rtc->pointer + 1) % RTC_REG_COUNT;
+	return data;
+}
+
+/*************************************************************************
+ Stop condition on the bus. Lost reference time restarts from the time 
+ keeper registers once a valid time is written into them.
+ 
+ context: RTC device.
+ 
+ Return: None
+*************************************************************************/
+VOID rtcStop(VOID* context)
+{
+	PRTC_DEVICE rtc = (PRTC_DEVICE)context;
+	TIME timeInfo;
+	
+	rtc->isPointerSet = FALSE;
+	
+	if((rtc->isReferenceValid == FALSE) && rtc->isTimeWritten && getRTCDeviceTime(rtc, &timeInfo))
+	{
+		rtc->referenceTime = ((UINT32)timeInfo.hours * 3600UL) + ((UINT32)timeInfo.minutes * 60UL) + timeInfo.seconds;
+		rtc->referenceDivider = rtc->divider;
+		rtc->isReferenceValid = TRUE;
+	}
+}
+
+/*************************************************************************
+ Get state of the SDA line driven by the device.
+ 
+ context: RTC device.
+ 
+ Return: FALSE while the device holds SDA low, otherwise TRUE.
+*************************************************************************/
+UCHAR rtcGetSDA(VOID* context)
+{
+	return ((PRTC_DEVICE)context)->stuckClocks ? FALSE : TRUE;
+}
+
+/*************************************************************************
+ SCL rising edge generated by the bus recovery. Stuck device shifts out 
+ the rest of the byte and releases SDA.
+ 
+ context: RTC device.
+ 
+ Return: None
+*************************************************************************/
+VOID rtcClock(VOID* context)
+{
+	PRTC_DEVICE rtc = (PRTC_DEVICE)context;
+	
+	if(rtc->stuckClocks)
+	{
+		rtc->stuckClocks--;
+	}
+}
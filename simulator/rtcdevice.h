@@ -0,0 +1,84 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     rtcdevice.h
+* Info:		DS1307 RTC model with fault injection attached to the virtual 
+*			TWI bus.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#ifndef RTC_DEVICE_HEADER
+#define RTC_DEVICE_HEADER
+
+#define RTC_DEVICE_ADDRESS	0xD0
+
+// DS1307 register map (time keeper registers followed by the RAM).
+#define RTC_REG_SECONDS		0x00
+#define RTC_REG_MINUTES		0x01
+#define RTC_REG_HOURS		0x02
+#define RTC_REG_DAY			0x03
+#define RTC_REG_DATE		0x04
+#define RTC_REG_MONTH		0x05
+#define RTC_REG_YEAR		0x06
+#define RTC_REG_CONTROL		0x07
+#define RTC_REG_COUNT		64
+
+#define RTC_RAM_START		0x08
+#define RTC_RAM_SIZE		(RTC_REG_COUNT - RTC_RAM_START)
+
+// Clock halt bit of the seconds register, 12 hour mode and PM bits of the 
+// hours register and the writable bits of the control register.
+#define RTC_CH_BIT			0x80
+#define RTC_12H_BIT			0x40
+#define RTC_PM_BIT			0x20
+#define RTC_CONTROL_MASK	0x93
+
+// Nominal frequency of the 32.768 kHz crystal oscillator.
+#define RTC_OSC_FREQUENCY	32768
+
+// Number of SCL clocks needed to release SDA stuck by the device (rest 
+// of the interrupted byte and the acknowledge bit).
+#define RTC_STUCK_CLOCKS	6
+
+// Length of the day kept by the reference time in seconds.
+#define RTC_DAY_SECONDS		86400UL
+
+// Injected faults.
+#define RTC_FAULT_NACK		0
+#define RTC_FAULT_STUCK_SDA	1
+#define RTC_FAULT_BATTERY	2
+#define RTC_FAULT_HALT		3
+#define RTC_FAULT_DELAY		4
+#define RTC_FAULT_DRIFT		5
+
+struct rtcDeviceStruct
+{
+	HOST_TWI_DEVICE bus;
+	UCHAR registers[RTC_REG_COUNT];
+	UCHAR pointer;
+	UCHAR isPointerSet;
+	UCHAR isNack;
+	UCHAR stuckClocks;
+	UINT64 lastUpdate;
+	UINT64 divider;
+	UINT64 cyclesPerSecond;
+	UINT32 seed;
+	UINT32 referenceTime;
+	UINT64 referenceDivider;
+	UCHAR isReferenceValid;
+	UCHAR isTimeWritten;
+};
+
+#define RTC_DEVICE	struct rtcDeviceStruct
+#define PRTC_DEVICE	RTC_DEVICE*
+
+VOID initRTCDevice(PRTC_DEVICE rtc, PTIME startTime, UCHAR is12Hour);
+VOID updateRTCDevice(PRTC_DEVICE rtc);
+UCHAR getRTCDeviceTime(PRTC_DEVICE rtc, PTIME timeInfo);
+UCHAR getRTCDeviceReference(PRTC_DEVICE rtc, PTIME timeInfo);
+VOID setRTCDeviceFault(PRTC_DEVICE rtc, UCHAR faultId, INT32 value);
+
+#endif
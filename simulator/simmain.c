@@ -0,0 +1,916 @@
+/*************************************************************************
+* Title:	Host simulator for programmable light controller firmware.
+* Author:	Dilshan R Jayakody <jayakody2000lk@gmail.com>
+* Project:	Programmable LED controller.
+* Homepage:	https://github.com/dilshan/programmable-light
+* File:     simmain.c
+* Info:		Accelerated time simulator. Runs the firmware against the
+*			virtual CPU clock, checks the light output and the software
+*			clock against the wall time and estimates the energy budget.
+* Compiler: GCC (Linux host)
+* Target:   Linux host
+**************************************************************************/
+
+#include "sysbasedef.h"
+#include "halmodule.h"
+#include "memmodule.h"
+#include "twimodule.h"
+#include "clockmodule.h"
+#include "nvrammodule.h"
+#include "rtcdevice.h"
+#include "inputmodule.h"
+#include "eventmodule.h"
+#include "displaytrace.h"
+#include "energymodel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include <unistd.h>
+
+// Default length of the simulation in days.
+#define SIM_DEFAULT_DAYS	7
+
+// Light output is checked in the middle of each minute of the wall time.
+#define SIM_CHECK_SECOND	30
+
+// Largest offset of the software clock from the wall time in seconds. 
+// RTC phase is reset when the firmware writes the time, so the clock can
+// trail the wall time by up to one second after the write.
+#define SIM_MAX_OFFSET		1
+
+// Time allowed for the firmware to start before the first check.
+#define SIM_SETTLE_TIME		HOST_MS_TO_CYCLES(2000)
+
+// Simulator events run at the middle of each RTC second.
+#define SIM_EVENT_PERIOD	((UINT64)F_CPU)
+#define SIM_EVENT_OFFSET	(SIM_EVENT_PERIOD / 2)
+
+// Maximum number of scripted faults and the default NACK fault duration.
+#define SIM_FAULT_COUNT		16
+#define SIM_NACK_TIME		60
+
+// Maximum number of scripted button presses and the default press time.
+#define SIM_PRESS_COUNT		16
+#define SIM_PRESS_TIME		200
+
+// Default length of the display analysis window in seconds.
+#define SIM_DISPLAY_TIME	10
+
+// Main loop of the firmware drives the sleep LED on every pass, at least
+// every EVENT_TICK_PERIOD. Longer gap means the main loop is blocked by 
+// the settings menu.
+#define SIM_MENU_GAP		HOST_MS_TO_CYCLES(4 * EVENT_TICK_PERIOD)
+
+// Firmware entry point (main of the firmware, renamed by the build).
+INT firmwareMain(VOID);
+
+// Software clock of the firmware (main.h).
+extern TIME _sysTime;
+extern volatile UCHAR _isTimeValid;
+
+struct simSlotStruct
+{
+	UINT startMinute;
+	UINT endMinute;
+};
+
+#define SIM_SLOT	struct simSlotStruct
+
+// Scripted RTC fault.
+struct simFaultStruct
+{
+	UINT32 time;
+	UCHAR faultId;
+	INT32 value;
+	UCHAR isApplied;
+};
+
+#define SIM_FAULT	struct simFaultStruct
+
+// Scripted button press.
+struct simPressStruct
+{
+	UINT64 pressTime;
+	UINT64 releaseTime;
+	UCHAR buttons;
+	UCHAR state;
+};
+
+#define SIM_PRESS	struct simPressStruct
+
+// States of the scripted button press.
+#define SIM_PRESS_PENDING	0x00
+#define SIM_PRESS_HOLD		0x01
+#define SIM_PRESS_DONE		0x02
+
+const char* _simFaultNames[] = {"nack", "stuck", "battery", "halt", "delay", "drift"};
+
+RTC_DEVICE _rtcDevice;
+SIM_SLOT _simSlots[SCHEDULE_SLOTS];
+UCHAR _simSlotCount = 0;
+UCHAR _simVerbose = FALSE;
+SIM_FAULT _simFaults[SIM_FAULT_COUNT];
+UCHAR _simFaultCount = 0;
+SIM_PRESS _simPresses[SIM_PRESS_COUNT];
+UCHAR _simPressCount = 0;
+
+DISPLAY_TRACE _displayTrace;
+UCHAR _simDisplayTrace = FALSE;
+ENERGY_MODEL _energyModel;
+
+jmp_buf _simExit;
+UINT64 _simEnd;
+UINT64 _simNextEvent;
+UCHAR _simLastLight;
+UCHAR _simLastMinute;
+
+UINT32 _simChecks;
+UINT32 _simMismatches;
+UINT32 _simTransitions;
+UINT32 _simLightSeconds;
+UINT32 _simWatchdogResets;
+UINT32 _simInvalidSamples;
+UINT32 _simOffsetErrors;
+INT _simMaxDrift;
+INT32 _simMaxOffset;
+
+/*************************************************************************
+ Print command line usage of the simulator.
+
+ name: Name of the executable.
+
+ Return: None
+*************************************************************************/
+VOID simUsage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-d days] [-t HH:MM:SS] [-m] [-r cause] [-s HH:MM-HH:MM]... [-f SEC:FAULT[=VALUE]]...\n", name);
+	fprintf(stderr, "          [-p SEC[:BUTTON[:MS]]]... [-D SEC[:LEN]] [-w file] [-c file] [-e writes] [-v]\n");
+	fprintf(stderr, "  -d  length of the simulation in days (default %d)\n", SIM_DEFAULT_DAYS);
+	fprintf(stderr, "  -t  initial time of the RTC (default 00:00:00)\n");
+	fprintf(stderr, "  -m  run the RTC in 12 hour mode\n");
+	fprintf(stderr, "  -r  reset cause of the first boot: por, ext, bor or wdt (default por)\n");
+	fprintf(stderr, "  -s  schedule slot, up to %d slots\n", SCHEDULE_SLOTS);
+	fprintf(stderr, "  -f  inject RTC fault at the given second of the simulation:\n");
+	fprintf(stderr, "        nack[=SEC]   NACK all transfers for SEC seconds (default %d)\n", SIM_NACK_TIME);
+	fprintf(stderr, "        stuck        hold SDA low until the bus is recovered\n");
+	fprintf(stderr, "        battery      battery loss, registers and RAM hold garbage\n");
+	fprintf(stderr, "        halt         stop the oscillator (set CH bit)\n");
+	fprintf(stderr, "        delay=US     stretch each data byte by US microseconds\n");
+	fprintf(stderr, "        drift=PPM    oscillator frequency error in ppm\n");
+	fprintf(stderr, "  -p  press option, up or down button at the given second (default option,\n");
+	fprintf(stderr, "      %d ms), button press makes the display show the time\n", SIM_PRESS_TIME);
+	fprintf(stderr, "  -D  analyze display multiplexing from the given second for LEN seconds\n");
+	fprintf(stderr, "      (default %d)\n", SIM_DISPLAY_TIME);
+	fprintf(stderr, "  -w  write display port writes of the analysis window into CSV file\n");
+	fprintf(stderr, "  -c  load measured CPU cycle costs (bench/build/cycles.txt)\n");
+	fprintf(stderr, "  -e  minimum number of EEPROM writes expected (default 0)\n");
+	fprintf(stderr, "  -v  print light transitions and faults\n");
+}
+
+/*************************************************************************
+ Format virtual time as day and time of the day.
+
+ cycles: Virtual time in CPU clock cycles.
+
+ buffer: Buffer to store the text (at least 24 characters).
+
+ Return: Pointer to the buffer.
+*************************************************************************/
+char* simFormatTime(UINT64 cycles, char* buffer)
+{
+	UINT64 seconds = cycles / F_CPU;
+
+	sprintf(buffer, "day %llu %02llu:%02llu:%02llu", (seconds / 86400) + 1, (seconds / 3600) % 24,
+		(seconds / 60) % 60, seconds % 60);
+	return buffer;
+}
+
+/*************************************************************************
+ Preload schedule slots into the legacy EEPROM layout. Firmware loads
+ this layout on the first boot (empty RTC RAM and configuration journal).
+
+ Return: None
+*************************************************************************/
+VOID simLoadSchedule()
+{
+	PUCHAR eeprom = hostEepromData();
+	UCHAR slotId;
+
+	for(slotId = 0; slotId < _simSlotCount; slotId++)
+	{
+		eeprom[MEM_ON_TIME(slotId) + 0] = 0;
+		eeprom[MEM_ON_TIME(slotId) + 1] = _simSlots[slotId].startMinute % 60;
+		eeprom[MEM_ON_TIME(slotId) + 2] = _simSlots[slotId].startMinute / 60;
+
+		eeprom[MEM_OFF_TIME(slotId) + 0] = 0;
+		eeprom[MEM_OFF_TIME(slotId) + 1] = _simSlots[slotId].endMinute % 60;
+		eeprom[MEM_OFF_TIME(slotId) + 2] = _simSlots[slotId].endMinute / 60;
+	}
+}
+
+/*************************************************************************
+ Determine expected light state from the programmed schedule.
+
+ currMinutes: Time in minutes since midnight.
+
+ Return: TRUE if light should be active, otherwise FALSE.
+*************************************************************************/
+UCHAR simIsLightExpected(UINT currMinutes)
+{
+	UCHAR slotId;
+	UINT startMinute;
+	UINT endMinute;
+
+	for(slotId = 0; slotId < _simSlotCount; slotId++)
+	{
+		startMinute = _simSlots[slotId].startMinute;
+		endMinute = _simSlots[slotId].endMinute;
+
+		if((startMinute < endMinute) && (currMinutes >= startMinute) && (currMinutes < endMinute))
+		{
+			return TRUE;
+		}
+
+		if((startMinute > endMinute) && ((currMinutes >= startMinute) || (currMinutes < endMinute)))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*************************************************************************
+ Apply scripted RTC faults which are due.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID simApplyFaults(UINT64 now)
+{
+	UCHAR faultId;
+	PUCHAR name;
+	char timeText[32];
+
+	for(faultId = 0; faultId < _simFaultCount; faultId++)
+	{
+		if(_simFaults[faultId].isApplied || (now < ((UINT64)_simFaults[faultId].time * F_CPU)))
+		{
+			continue;
+		}
+
+		_simFaults[faultId].isApplied = TRUE;
+		setRTCDeviceFault(&_rtcDevice, _simFaults[faultId].faultId, _simFaults[faultId].value);
+
+		if(_simVerbose)
+		{
+			name = (PUCHAR)_simFaultNames[_simFaults[faultId].faultId];
+			printf("%s  RTC fault %s %d\n", simFormatTime(now, timeText), name, _simFaults[faultId].value);
+		}
+	}
+}
+
+/*************************************************************************
+ Apply scripted button presses and releases which are due.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID simApplyPresses(UINT64 now)
+{
+	UCHAR pressId;
+	UCHAR buttons = 0;
+
+	for(pressId = 0; pressId < _simPressCount; pressId++)
+	{
+		if((_simPresses[pressId].state == SIM_PRESS_PENDING) && (now >= _simPresses[pressId].pressTime))
+		{
+			_simPresses[pressId].state = SIM_PRESS_HOLD;
+		}
+
+		if((_simPresses[pressId].state == SIM_PRESS_HOLD) && (now >= _simPresses[pressId].releaseTime))
+		{
+			_simPresses[pressId].state = SIM_PRESS_DONE;
+		}
+
+		if(_simPresses[pressId].state == SIM_PRESS_HOLD)
+		{
+			buttons |= _simPresses[pressId].buttons;
+		}
+	}
+
+	hostSetButtons(buttons);
+}
+
+/*************************************************************************
+ Get time of the next simulator event.
+
+ Return: Virtual time of the next event in CPU clock cycles.
+*************************************************************************/
+UINT64 simGetNextEvent()
+{
+	UINT64 next = _simNextEvent;
+	UINT64 menuTime = hostGetSleepLEDTime();
+	UCHAR pressId;
+
+	// Energy mode changes to the menu when the main loop stops.
+	if((menuTime != HOST_NEVER) && (_energyModel.mode != ENERGY_MODE_MENU) && ((menuTime + SIM_MENU_GAP) < next))
+	{
+		next = menuTime + SIM_MENU_GAP;
+	}
+
+	for(pressId = 0; pressId < _simPressCount; pressId++)
+	{
+		if((_simPresses[pressId].state == SIM_PRESS_PENDING) && (_simPresses[pressId].pressTime < next))
+		{
+			next = _simPresses[pressId].pressTime;
+		}
+
+		if((_simPresses[pressId].state == SIM_PRESS_HOLD) && (_simPresses[pressId].releaseTime < next))
+		{
+			next = _simPresses[pressId].releaseTime;
+		}
+	}
+
+	return next;
+}
+
+/*************************************************************************
+ Get current operating mode of the firmware for the energy model. Mode 
+ is derived from the outputs: the main loop stops driving the sleep LED 
+ while the menu is open, and the LED is lit only while the display is 
+ blank and the light is off.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: Operating mode (ENERGY_MODE_x).
+*************************************************************************/
+UCHAR simGetEnergyMode(UINT64 now)
+{
+	UINT64 menuTime = hostGetSleepLEDTime();
+
+	if((menuTime != HOST_NEVER) && (now >= (menuTime + SIM_MENU_GAP)))
+	{
+		return ENERGY_MODE_MENU;
+	}
+
+	if(hostGetLightOutput() != 0)
+	{
+		return ENERGY_MODE_LIGHT;
+	}
+
+	return (hostReadPort(HOST_PORTB) & ENERGY_SLEEP_LED_PIN) ? ENERGY_MODE_BLANK : ENERGY_MODE_DISPLAY;
+}
+
+/*************************************************************************
+ Update operating mode and the light output of the energy model if they 
+ are changed.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID simUpdateEnergyMode(UINT64 now)
+{
+	UCHAR mode = simGetEnergyMode(now);
+	UCHAR lightDuty = hostGetLightOutput();
+
+	if((mode != _energyModel.mode) || (lightDuty != _energyModel.lightDuty))
+	{
+		updateEnergyModel(&_energyModel, now, mode, lightDuty);
+	}
+}
+
+/*************************************************************************
+ Receive port writes of the firmware.
+
+ now: Virtual time of the write in CPU clock cycles.
+
+ port: Port number (HOST_PORTx).
+
+ value: Value written into the port.
+
+ Return: None
+*************************************************************************/
+VOID simOnPortWrite(UINT64 now, UCHAR port, UCHAR value)
+{
+	recordEnergyPort(&_energyModel, now, port, value);
+
+	// Sleep LED and light output changes are the mode transitions.
+	if(port == HOST_PORTB)
+	{
+		simUpdateEnergyMode(now);
+	}
+
+	if(_simDisplayTrace)
+	{
+		recordDisplayTrace(&_displayTrace, now, port, value);
+	}
+}
+
+/*************************************************************************
+ Check software clock of the firmware against the wall time.
+
+ now: Current virtual time in CPU clock cycles.
+
+ wallTime: Current wall time.
+
+ Return: None
+*************************************************************************/
+VOID simCheckOffset(UINT64 now, PTIME wallTime)
+{
+	INT32 offset;
+	char timeText[32];
+
+	offset = (((INT32)_sysTime.hours - wallTime->hours) * 3600L) + (((INT32)_sysTime.minutes - wallTime->minutes) * 60L) + 
+		((INT32)_sysTime.seconds - wallTime->seconds);
+
+	// Offset is the shortest distance around the midnight.
+	if(offset >= (INT32)(RTC_DAY_SECONDS / 2))
+	{
+		offset -= RTC_DAY_SECONDS;
+	}
+	else if(offset < -(INT32)(RTC_DAY_SECONDS / 2))
+	{
+		offset += RTC_DAY_SECONDS;
+	}
+
+	if(abs(offset) > abs(_simMaxOffset))
+	{
+		_simMaxOffset = offset;
+	}
+
+	if(abs(offset) <= SIM_MAX_OFFSET)
+	{
+		return;
+	}
+
+	_simOffsetErrors++;
+
+	if(_simVerbose || (_simOffsetErrors <= 10))
+	{
+		printf("%s  time %02d:%02d:%02d  OFFSET clock is %02d:%02d:%02d (%d s)\n", simFormatTime(now, timeText),
+			wallTime->hours, wallTime->minutes, wallTime->seconds, _sysTime.hours, _sysTime.minutes, _sysTime.seconds, offset);
+	}
+}
+
+/*************************************************************************
+ Run simulator events. Scripted button presses are applied when they
+ are due. Once per second scripted faults are applied, light output is 
+ sampled and the software clock is checked against the wall time. Light
+ output is checked against the schedule once per minute of the wall 
+ time. Simulation ends when the virtual time reaches the requested 
+ length.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID simRunEvents(UINT64 now)
+{
+	TIME wallTime;
+	UINT currMinutes;
+	UCHAR isLightOn;
+	UCHAR isExpected;
+	UCHAR isValid;
+	char timeText[32];
+
+	if(now >= _simEnd)
+	{
+		longjmp(_simExit, 1);
+	}
+
+	simApplyPresses(now);
+	simUpdateEnergyMode(now);
+
+	if(now < _simNextEvent)
+	{
+		return;
+	}
+
+	_simNextEvent += SIM_EVENT_PERIOD;
+
+	// Largest software clock drift seen on the RTC synchronizations.
+	if(abs(getClockDrift()) > abs(_simMaxDrift))
+	{
+		_simMaxDrift = getClockDrift();
+	}
+
+	simApplyFaults(now);
+
+	isValid = getRTCDeviceReference(&_rtcDevice, &wallTime);
+	currMinutes = (wallTime.hours * 60) + wallTime.minutes;
+	isLightOn = (hostGetLightOutput() != 0) ? TRUE : FALSE;
+
+	if(isLightOn)
+	{
+		_simLightSeconds++;
+	}
+
+	if(isLightOn != _simLastLight)
+	{
+		_simTransitions++;
+		_simLastLight = isLightOn;
+
+		if(_simVerbose)
+		{
+			printf("%s  time %02d:%02d:%02d  light %s\n", simFormatTime(now, timeText), wallTime.hours,
+				wallTime.minutes, wallTime.seconds, isLightOn ? "on" : "off");
+		}
+	}
+
+	// Wall time is unknown after the RTC battery loss until the time is set.
+	if(isValid == FALSE)
+	{
+		_simInvalidSamples++;
+		return;
+	}
+
+	if(now < SIM_SETTLE_TIME)
+	{
+		return;
+	}
+
+	if(_isTimeValid)
+	{
+		simCheckOffset(now, &wallTime);
+	}
+
+	if((wallTime.seconds < SIM_CHECK_SECOND) || (wallTime.minutes == _simLastMinute))
+	{
+		return;
+	}
+
+	_simLastMinute = wallTime.minutes;
+	_simChecks++;
+
+	isExpected = simIsLightExpected(currMinutes);
+	if(isExpected != isLightOn)
+	{
+		_simMismatches++;
+
+		if(_simVerbose || (_simMismatches <= 10))
+		{
+			printf("%s  time %02d:%02d:%02d  MISMATCH light is %s, expected %s\n", simFormatTime(now, timeText),
+				wallTime.hours, wallTime.minutes, wallTime.seconds, isLightOn ? "on" : "off", isExpected ? "on" : "off");
+		}
+	}
+}
+
+/*************************************************************************
+ Watchdog timer expired. Firmware is stuck, so the simulation ends.
+
+ now: Current virtual time in CPU clock cycles.
+
+ Return: None
+*************************************************************************/
+VOID simOnWatchdogReset(UINT64 now)
+{
+	char timeText[32];
+
+	_simWatchdogResets++;
+	printf("%s  watchdog reset\n", simFormatTime(now, timeText));
+	longjmp(_simExit, 1);
+}
+
+/*************************************************************************
+ Parse time in HH:MM or HH:MM:SS format.
+
+ text: Text to parse.
+
+ timeInfo: Pointer to store the time.
+
+ Return: TRUE if time is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR simParseTime(const char* text, PTIME timeInfo)
+{
+	unsigned int hours, minutes, seconds = 0;
+
+	if(sscanf(text, "%u:%u:%u", &hours, &minutes, &seconds) < 2)
+	{
+		return FALSE;
+	}
+
+	if((hours > 23) || (minutes > 59) || (seconds > 59))
+	{
+		return FALSE;
+	}
+
+	timeInfo->hours = hours;
+	timeInfo->minutes = minutes;
+	timeInfo->seconds = seconds;
+	return TRUE;
+}
+
+/*************************************************************************
+ Parse schedule slot in HH:MM-HH:MM format.
+
+ text: Text to parse.
+
+ Return: TRUE if slot is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR simParseSlot(const char* text)
+{
+	TIME startTime;
+	TIME endTime;
+	const char* separator = strchr(text, '-');
+
+	if((separator == NULL) || (_simSlotCount >= SCHEDULE_SLOTS))
+	{
+		return FALSE;
+	}
+
+	if((simParseTime(text, &startTime) == FALSE) || (simParseTime(separator + 1, &endTime) == FALSE))
+	{
+		return FALSE;
+	}
+
+	_simSlots[_simSlotCount].startMinute = (startTime.hours * 60) + startTime.minutes;
+	_simSlots[_simSlotCount].endMinute = (endTime.hours * 60) + endTime.minutes;
+	_simSlotCount++;
+	return TRUE;
+}
+
+/*************************************************************************
+ Parse scripted fault in SEC:FAULT[=VALUE] format.
+
+ text: Text to parse.
+
+ Return: TRUE if fault is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR simParseFault(const char* text)
+{
+	unsigned int time;
+	char name[16];
+	int value = 0;
+	int fields = sscanf(text, "%u:%15[a-z]=%d", &time, name, &value);
+	UCHAR faultId;
+
+	if((fields < 2) || ((_simFaultCount + 2) > SIM_FAULT_COUNT))
+	{
+		return FALSE;
+	}
+
+	for(faultId = 0; faultId < (sizeof(_simFaultNames) / sizeof(_simFaultNames[0])); faultId++)
+	{
+		if(strcmp(name, _simFaultNames[faultId]) != 0)
+		{
+			continue;
+		}
+
+		_simFaults[_simFaultCount].time = time;
+		_simFaults[_simFaultCount].faultId = faultId;
+		_simFaults[_simFaultCount].value = value;
+		_simFaults[_simFaultCount].isApplied = FALSE;
+
+		// NACK fault is scripted as start and end events.
+		if(faultId == RTC_FAULT_NACK)
+		{
+			_simFaults[_simFaultCount].value = TRUE;
+			_simFaultCount++;
+
+			_simFaults[_simFaultCount].time = time + ((fields == 3) ? (unsigned int)value : SIM_NACK_TIME);
+			_simFaults[_simFaultCount].faultId = faultId;
+			_simFaults[_simFaultCount].value = FALSE;
+			_simFaults[_simFaultCount].isApplied = FALSE;
+		}
+
+		_simFaultCount++;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*************************************************************************
+ Parse scripted button press in SEC[:BUTTON[:MS]] format.
+
+ text: Text to parse.
+
+ Return: TRUE if button press is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR simParsePress(const char* text)
+{
+	unsigned int time;
+	unsigned int holdTime = SIM_PRESS_TIME;
+	char name[16] = "option";
+	UCHAR buttons;
+
+	if((sscanf(text, "%u:%15[a-z]:%u", &time, name, &holdTime) < 1) || (_simPressCount >= SIM_PRESS_COUNT))
+	{
+		return FALSE;
+	}
+
+	if(strcmp(name, "option") == 0)
+	{
+		buttons = BUTTON_OPTION;
+	}
+	else if(strcmp(name, "up") == 0)
+	{
+		buttons = BUTTON_UP;
+	}
+	else if(strcmp(name, "down") == 0)
+	{
+		buttons = BUTTON_DOWN;
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	_simPresses[_simPressCount].pressTime = (UINT64)time * F_CPU;
+	_simPresses[_simPressCount].releaseTime = _simPresses[_simPressCount].pressTime + HOST_MS_TO_CYCLES(holdTime);
+	_simPresses[_simPressCount].buttons = buttons;
+	_simPresses[_simPressCount].state = SIM_PRESS_PENDING;
+	_simPressCount++;
+	return TRUE;
+}
+
+/*************************************************************************
+ Parse reset cause of the first boot.
+
+ text: por, ext, bor or wdt.
+
+ resetCause: Pointer to store the MCUCSR flags.
+
+ Return: TRUE if reset cause is valid, otherwise FALSE.
+*************************************************************************/
+UCHAR simParseResetCause(const char* text, PUCHAR resetCause)
+{
+	if(strcmp(text, "por") == 0)
+	{
+		*resetCause = (1 << PORF);
+	}
+	else if(strcmp(text, "ext") == 0)
+	{
+		*resetCause = (1 << EXTRF);
+	}
+	else if(strcmp(text, "bor") == 0)
+	{
+		*resetCause = (1 << BORF);
+	}
+	else if(strcmp(text, "wdt") == 0)
+	{
+		*resetCause = (1 << WDRF);
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int main(int argc, char** argv)
+{
+	TIME startTime = {0, 0, 0};
+	unsigned int days = SIM_DEFAULT_DAYS;
+	clock_t wallStart;
+	double wallTime;
+	int option;
+	UCHAR isPassed;
+	UCHAR is12Hour = FALSE;
+	UCHAR resetCause = (1 << PORF);
+	unsigned int displayStart = 0;
+	unsigned int displayLength = SIM_DISPLAY_TIME;
+	unsigned int eepromWrites = 0;
+	FILE* capture = NULL;
+
+	while((option = getopt(argc, argv, "d:t:mr:s:f:p:D:w:c:e:vh")) != -1)
+	{
+		switch(option)
+		{
+			case 'd':
+				days = (unsigned int)atoi(optarg);
+				break;
+			case 't':
+				if(simParseTime(optarg, &startTime) == FALSE)
+				{
+					fprintf(stderr, "invalid time: %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 's':
+				if(simParseSlot(optarg) == FALSE)
+				{
+					fprintf(stderr, "invalid schedule slot: %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'm':
+				is12Hour = TRUE;
+				break;
+			case 'r':
+				if(simParseResetCause(optarg, &resetCause) == FALSE)
+				{
+					fprintf(stderr, "invalid reset cause: %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'f':
+				if(simParseFault(optarg) == FALSE)
+				{
+					fprintf(stderr, "invalid fault: %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'p':
+				if(simParsePress(optarg) == FALSE)
+				{
+					fprintf(stderr, "invalid button press: %s\n", optarg);
+					return 2;
+				}
+				break;
+			case 'D':
+				if(sscanf(optarg, "%u:%u", &displayStart, &displayLength) < 1)
+				{
+					fprintf(stderr, "invalid display window: %s\n", optarg);
+					return 2;
+				}
+				_simDisplayTrace = TRUE;
+				break;
+			case 'w':
+				if((capture = fopen(optarg, "w")) == NULL)
+				{
+					fprintf(stderr, "unable to create %s\n", optarg);
+					return 2;
+				}
+				_simDisplayTrace = TRUE;
+				break;
+			case 'c':
+				if(hostLoadCosts(optarg) == FALSE)
+				{
+					return 2;
+				}
+				break;
+			case 'e':
+				eepromWrites = (unsigned int)atoi(optarg);
+				break;
+			case 'v':
+				_simVerbose = TRUE;
+				break;
+			default:
+				simUsage(argv[0]);
+				return 2;
+		}
+	}
+
+	hostReset(resetCause);
+	initEnergyModel(&_energyModel);
+	hostSetPortTrace(simOnPortWrite);
+
+	if(_simDisplayTrace)
+	{
+		initDisplayTrace(&_displayTrace, (UINT64)displayStart * F_CPU, (UINT64)(displayStart + displayLength) * F_CPU, capture);
+	}
+
+	simLoadSchedule();
+	initRTCDevice(&_rtcDevice, &startTime, is12Hour);
+
+	// Faults scripted at 0 s are present at the power up.
+	simApplyFaults(0);
+
+	_simEnd = HOST_MS_TO_CYCLES((UINT64)days * 86400000ULL);
+	_simNextEvent = SIM_EVENT_OFFSET;
+	_simLastLight = FALSE;
+	_simLastMinute = 0xFF;
+
+	wallStart = clock();
+
+	if(setjmp(_simExit) == 0)
+	{
+		firmwareMain();
+	}
+
+	wallTime = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+	isPassed = ((_simMismatches == 0) && (_simOffsetErrors == 0) && (_simWatchdogResets == 0) && ((_simChecks > 0) || (_simInvalidSamples > 0)) &&
+		(hostEepromWriteCount() >= eepromWrites)) ? TRUE : FALSE;
+
+	printf("simulated time  : %u days (%.0f s) in %.3f s wall time\n", days, (double)days * 86400.0, wallTime);
+	printf("schedule checks : %u, mismatches %u\n", _simChecks, _simMismatches);
+	printf("light on        : %.2f h, %u transitions\n", _simLightSeconds / 3600.0, _simTransitions);
+	printf("RTC invalid     : %u s\n", _simInvalidSamples);
+	printf("watchdog resets : %u\n", _simWatchdogResets);
+	printf("light counters  : %u on, %u min (RTC RAM)\n", getLightOnCount(), getLightOnMinutes());
+	printf("clock drift     : %d s last sync, %d s max\n", getClockDrift(), _simMaxDrift);
+	printf("clock offset    : %d s max, %u errors\n", _simMaxOffset, _simOffsetErrors);
+	printf("TWI errors      : %u\n", getTWIErrorCount());
+	printf("EEPROM writes   : %u, %u expected\n", hostEepromWriteCount(), eepromWrites);
+
+	updateEnergyModel(&_energyModel, hostGetCycles(), simGetEnergyMode(hostGetCycles()), hostGetLightOutput());
+	printEnergyReport(&_energyModel);
+
+	if(_simDisplayTrace)
+	{
+		printDisplayReport(&_displayTrace, hostGetCycles());
+	}
+
+	printf("result          : %s\n", isPassed ? "PASS" : "FAIL");
+
+	return isPassed ? 0 : 1;
+}